@@ -27,12 +27,16 @@
 #include <risa/Copy/D2H.h>
 #include <risa/Copy/H2D.h>
 #include <risa/Fan2Para/Fan2Para.h>
+#include <risa/FanBeam/FanBeamReconstruction.h>
 #include <risa/Masking/Masking.h>
 #include <risa/Loader/OfflineLoader.h>
 #include <risa/Loader/OfflineLoader_perfTest.h>
 #include <risa/Saver/OfflineSaver.h>
 #include <risa/Receiver/Receiver.h>
 #include <risa/Reordering/Reordering.h>
+#include <risa/DetectorInterpolation/DetectorInterpolation.h>
+#include <risa/ConfigReader/ConfigReader.h>
+#include <risa/Basics/DetectorLayout.h>
 
 #include <glados/Image.h>
 #include <glados/ImageLoader.h>
@@ -54,6 +58,8 @@
 #include <iostream>
 #include <cstdlib>
 #include <exception>
+#include <stdexcept>
+#include <memory>
 #include <string>
 #include <thread>
 
@@ -95,10 +101,12 @@ int main(int argc, char *argv[]) {
    using sourceStage = glados::pipeline::SourceStage<offlineLoader>;
    using copyStageH2D = glados::pipeline::Stage<risa::cuda::H2D>;
    using reorderingStage = glados::pipeline::Stage<risa::cuda::Reordering>;
+   using interpolationStage = glados::pipeline::Stage<risa::cuda::DetectorInterpolation>;
    using attenuationStage = glados::pipeline::Stage<risa::cuda::Attenuation>;
    using fan2ParaStage = glados::pipeline::Stage<risa::cuda::Fan2Para>;
    using filterStage = glados::pipeline::Stage<risa::cuda::Filter>;
    using backProjectionStage = glados::pipeline::Stage<risa::cuda::Backprojection>;
+   using fanBeamStage = glados::pipeline::Stage<risa::cuda::FanBeamReconstruction>;
    using maskingStage = glados::pipeline::Stage<risa::cuda::Masking>;
    using copyStageD2H = glados::pipeline::Stage<risa::cuda::D2H>;
    using sinkStage = glados::pipeline::SinkStage<offlineSaver>;
@@ -110,28 +118,81 @@ int main(int argc, char *argv[]) {
       //set up pipeline
       auto pipeline = glados::pipeline::Pipeline { };
 
+      //the attenuation stage can reorder the raw data itself, the reordering stage is skipped then
+      risa::DetectorLayout layout;
+      if(layout.readConfig(configFile))
+         throw std::runtime_error("The detector layout could not be read from the configuration file.");
+      const bool fuseReordering = layout.fuseReordering();
+      risa::ConfigReader configReader(configFile.data());
+      bool interpolateDefectDetectors = false;
+      configReader.lookupValue("interpolateDefectDetectors", interpolateDefectDetectors);
+      //"rebinning": Fan2Para, Filter and Backprojection, "fanBeam": direct fan beam reconstruction
+      std::string reconstructionMethod = "rebinning";
+      configReader.lookupValue("reconstructionMethod", reconstructionMethod);
+      if(reconstructionMethod != "rebinning" && reconstructionMethod != "fanBeam")
+         throw std::runtime_error("Unknown reconstructionMethod \"" + reconstructionMethod + "\", use \"rebinning\" or \"fanBeam\".");
+      const bool fanBeamReconstruction = reconstructionMethod == "fanBeam";
+
       auto h2d = pipeline.create<copyStageH2D>(configFile);
-      auto reordering = pipeline.create<reorderingStage>(configFile);
+      std::shared_ptr<reorderingStage> reordering;
+      if(!fuseReordering)
+         reordering = pipeline.create<reorderingStage>(configFile);
+      std::shared_ptr<interpolationStage> interpolation;
+      if(interpolateDefectDetectors)
+         interpolation = pipeline.create<interpolationStage>(configFile);
       auto attenuation = pipeline.create<attenuationStage>(configFile);
-      auto fan2Para = pipeline.create<fan2ParaStage>(configFile);
-      auto filter = pipeline.create<filterStage>(configFile);
-      auto backProjection = pipeline.create<backProjectionStage>(configFile);
+      std::shared_ptr<fan2ParaStage> fan2Para;
+      std::shared_ptr<filterStage> filter;
+      std::shared_ptr<backProjectionStage> backProjection;
+      std::shared_ptr<fanBeamStage> fanBeam;
+      if(fanBeamReconstruction)
+         fanBeam = pipeline.create<fanBeamStage>(configFile);
+      else{
+         fan2Para = pipeline.create<fan2ParaStage>(configFile);
+         filter = pipeline.create<filterStage>(configFile);
+         backProjection = pipeline.create<backProjectionStage>(configFile);
+      }
       //auto masking = pipeline.create<maskingStage>(configFile);
       auto d2h = pipeline.create<copyStageD2H>(configFile);
       auto sink = pipeline.create<sinkStage>(outputPath, prefix, configFile);
       auto source = pipeline.create<sourceStage>(address, configFile);
 
       pipeline.connect(source, h2d);
-      pipeline.connect(h2d, reordering);
-      pipeline.connect(reordering, attenuation);
-      pipeline.connect(attenuation, fan2Para);
-      pipeline.connect(fan2Para, filter);
-      pipeline.connect(filter, backProjection);
-      //pipeline.connect(backProjection, masking);
-      pipeline.connect(backProjection, d2h);
+      if(fuseReordering)
+         pipeline.connect(h2d, attenuation);
+      else if(interpolateDefectDetectors){
+         pipeline.connect(h2d, reordering);
+         pipeline.connect(reordering, interpolation);
+         pipeline.connect(interpolation, attenuation);
+      }
+      else{
+         pipeline.connect(h2d, reordering);
+         pipeline.connect(reordering, attenuation);
+      }
+      if(fanBeamReconstruction){
+         pipeline.connect(attenuation, fanBeam);
+         pipeline.connect(fanBeam, d2h);
+      }
+      else{
+         pipeline.connect(attenuation, fan2Para);
+         pipeline.connect(fan2Para, filter);
+         pipeline.connect(filter, backProjection);
+         //pipeline.connect(backProjection, masking);
+         pipeline.connect(backProjection, d2h);
+      }
       pipeline.connect(d2h, sink);
 
-      pipeline.run(source, h2d, reordering, attenuation, fan2Para, filter, backProjection, d2h, sink);
+      pipeline.run(source, h2d);
+      if(!fuseReordering)
+         pipeline.run(reordering);
+      if(interpolateDefectDetectors)
+         pipeline.run(interpolation);
+      pipeline.run(attenuation);
+      if(fanBeamReconstruction)
+         pipeline.run(fanBeam);
+      else
+         pipeline.run(fan2Para, filter, backProjection);
+      pipeline.run(d2h, sink);
       BOOST_LOG_TRIVIAL(info) << "Initialization finished.";
 
       for (auto i = 0; i < numberofDevices; i++){
@@ -0,0 +1,220 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ */
+
+#include <risa/UDPServer/UDPServer.h>
+
+#include <boost/log/core.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/log/expressions.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const std::size_t headerSize = sizeof(std::size_t) + sizeof(unsigned short);
+const unsigned short partsPerSinogram = 10;
+//! the exit code, that marks a skipped test for CTest (SKIP_RETURN_CODE) and automake
+const int exitSkipped = 77;
+
+enum class Result {
+   passed,
+   failed,
+   skipped
+};
+
+auto toString(Result result) -> std::string {
+   switch(result){
+      case Result::passed: return "passed";
+      case Result::failed: return "FAILED";
+      default: return "SKIPPED";
+   }
+}
+
+struct Statistics {
+   std::size_t received{0u};
+   std::size_t lost{0u};
+   std::size_t duplicates{0u};
+   std::size_t corrupt{0u};
+};
+
+auto payloadValue(std::size_t packet, std::size_t i) -> unsigned short {
+   return (unsigned short)(packet * 31u + i * 7u);
+}
+
+//! sends all packets, except the dropped ones, to the given port on the loopback interface
+auto send(int port, std::size_t numberOfPackets, std::size_t payloadSize, std::size_t dropEvery) -> void {
+   int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+   sockaddr_in target;
+   std::memset(&target, 0, sizeof(target));
+   target.sin_family = AF_INET;
+   target.sin_port = htons(port);
+   inet_pton(AF_INET, "127.0.0.1", &target.sin_addr);
+
+   //reorder the packets within windows of 16, like the network may do
+   std::vector<std::size_t> order(numberOfPackets);
+   for(auto i = 0u; i < numberOfPackets; i++)
+      order[i] = i;
+   std::mt19937 generator(42);
+   for(auto start = 0u; start < numberOfPackets; start += 16)
+      std::shuffle(order.begin() + start, order.begin() + std::min<std::size_t>(start + 16, numberOfPackets), generator);
+
+   std::vector<char> packet(headerSize + payloadSize * sizeof(unsigned short));
+   auto sent = 0u;
+   for(auto packetNumber : order){
+      if(dropEvery > 0 && packetNumber % dropEvery == dropEvery - 1)
+         continue;
+      const std::size_t index = packetNumber / partsPerSinogram;
+      const unsigned short partID = packetNumber % partsPerSinogram;
+      std::memcpy(packet.data(), &index, sizeof(index));
+      std::memcpy(packet.data() + sizeof(index), &partID, sizeof(partID));
+      unsigned short* payload = (unsigned short*)(packet.data() + headerSize);
+      for(auto i = 0u; i < payloadSize; i++)
+         payload[i] = payloadValue(packetNumber, i);
+      sendto(sock, packet.data(), packet.size(), 0, (sockaddr*)&target, sizeof(target));
+      //pace the sender, so that the socket buffer does not overflow on slow machines
+      if(++sent % 64 == 0)
+         std::this_thread::sleep_for(std::chrono::microseconds(200));
+   }
+   close(sock);
+}
+
+//! receives all packets with the UDPServer and verifies them
+auto receive(risa::UDPServer& server, std::size_t numberOfPackets, std::size_t payloadSize) -> Statistics {
+   const std::size_t batchSize = 64;
+   risa::PacketBatch batch(batchSize, headerSize, payloadSize * sizeof(unsigned short));
+   std::vector<unsigned short> payloads(batchSize * payloadSize);
+   for(auto i = 0u; i < batchSize; i++)
+      batch.set_payload(i, (char*)(payloads.data() + i * payloadSize));
+
+   Statistics statistics;
+   std::vector<bool> seen(numberOfPackets, false);
+   //the server times out, when the sender is finished
+   int count;
+   while((count = server.recv_batch(batch)) > 0){
+      for(auto i = 0; i < count; i++){
+         std::size_t index;
+         unsigned short partID;
+         std::memcpy(&index, batch.header(i), sizeof(index));
+         std::memcpy(&partID, batch.header(i) + sizeof(index), sizeof(partID));
+         const std::size_t packetNumber = index * partsPerSinogram + partID;
+         if(batch.packet_bytes(i) != (int)(headerSize + payloadSize * sizeof(unsigned short))
+               || partID >= partsPerSinogram || packetNumber >= numberOfPackets){
+            statistics.corrupt++;
+            continue;
+         }
+         if(seen[packetNumber]){
+            statistics.duplicates++;
+            continue;
+         }
+         seen[packetNumber] = true;
+         const unsigned short* payload = (const unsigned short*)batch.payload(i);
+         bool valid = true;
+         for(auto j = 0u; j < payloadSize && valid; j++)
+            valid = payload[j] == payloadValue(packetNumber, j);
+         if(valid)
+            statistics.received++;
+         else
+            statistics.corrupt++;
+      }
+   }
+   statistics.lost = std::count(seen.cbegin(), seen.cend(), false);
+   return statistics;
+}
+
+auto runBackend(const std::string& backend, int port, std::size_t numberOfPackets,
+      std::size_t payloadSize, std::size_t dropEvery) -> Result {
+   risa::UDPServer server("127.0.0.1", port);
+   server.set_timeout(1);
+   int bufferSize = 8 * 1024 * 1024;
+   setsockopt(server.get_socket(), SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+   if(backend == "io_uring" && !server.enable_io_uring(256, headerSize + payloadSize * sizeof(unsigned short))){
+      BOOST_LOG_TRIVIAL(warning) << "udpLoopback: io_uring is not available, skipping this backend.";
+      return Result::skipped;
+   }
+
+   std::thread sender(send, port, numberOfPackets, payloadSize, dropEvery);
+   auto statistics = receive(server, numberOfPackets, payloadSize);
+   sender.join();
+
+   const std::size_t dropped = dropEvery > 0 ? numberOfPackets / dropEvery : 0u;
+   const bool passed = statistics.received == numberOfPackets - dropped && statistics.lost == dropped
+         && statistics.duplicates == 0u && statistics.corrupt == 0u;
+   BOOST_LOG_TRIVIAL(info) << "udpLoopback: " << backend << ": received " << statistics.received
+         << ", lost " << statistics.lost << " (dropped " << dropped << "), duplicates " << statistics.duplicates
+         << ", corrupt " << statistics.corrupt << ": " << (passed ? "passed" : "FAILED");
+   return passed ? Result::passed : Result::failed;
+}
+
+}
+
+//! Sends packets over the loopback interface and receives them with both UDPServer backends
+/**
+ * The packets have the layout of the detector packets: a header with the packet number and the
+ * part ID, followed by the payload. The sender shuffles the packets within small windows and leaves
+ * out every dropEvery-th packet. The receiver checks the size and the content of each packet and
+ * compares the number of received, lost, duplicate and corrupt packets with what was sent.
+ *
+ * Call it like this: ./udpLoopback [numberOfPackets] [payloadSize] [dropEvery] [port]
+ * It returns EXIT_FAILURE, if any backend delivered wrong statistics or payloads, and 77, if
+ * all tested backends passed, but a backend could not be tested, e.g. io_uring, if RISA was built
+ * without RISA_IO_URING or the kernel does not support it.
+ */
+int main(int argc, char *argv[]) {
+   boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::info);
+
+   const std::size_t numberOfPackets = argc > 1 ? std::stoul(argv[1]) : 100000u;
+   const std::size_t payloadSize = argc > 2 ? std::stoul(argv[2]) : 800u;
+   const std::size_t dropEvery = argc > 3 ? std::stoul(argv[3]) : 97u;
+   const int port = argc > 4 ? std::stoi(argv[4]) : 4999;
+
+   const std::vector<std::string> backends{"recvmmsg", "io_uring"};
+   std::vector<Result> results;
+   try {
+      for(const auto& backend : backends)
+         results.push_back(runBackend(backend, port, numberOfPackets, payloadSize, dropEvery));
+   } catch (const std::runtime_error& err) {
+      BOOST_LOG_TRIVIAL(error) << "udpLoopback: " << err.what();
+      return EXIT_FAILURE;
+   }
+
+   std::string summary;
+   for(auto i = 0u; i < backends.size(); i++)
+      summary += (i > 0 ? ", " : "") + backends[i] + " " + toString(results[i]);
+   BOOST_LOG_TRIVIAL(info) << "udpLoopback: " << summary;
+   if(std::find(results.cbegin(), results.cend(), Result::failed) != results.cend())
+      return EXIT_FAILURE;
+   if(std::find(results.cbegin(), results.cend(), Result::skipped) != results.cend())
+      return exitSkipped;
+   return EXIT_SUCCESS;
+}
@@ -24,6 +24,9 @@
 #ifndef ATTENUATION_H_
 #define ATTENUATION_H_
 
+#include <risa/Basics/sinogramType.h>
+#include <risa/Basics/DetectorLayout.h>
+
 #include <glados/Image.h>
 #include <glados/cuda/DeviceMemoryManager.h>
 #include <glados/Queue.h>
@@ -36,6 +39,17 @@
 namespace risa {
 namespace cuda {
 
+namespace detail {
+   /**
+   *  This enum represents the supported ways to compute
+   *  the attenuation coefficients
+   */
+   enum AttenuationMethod: short {
+      direct,        //!< the logarithm of the normalized raw value is evaluated for every sample
+      lookupTable    //!< the logarithms are precomputed, each sample needs two loads and a subtraction
+   };
+}
+
 //!   CUDA kernel to compute the attenuation coefficients
 /**
  * This CUDA kernel computes the attenuation coefficient for the fan to parallel beam sinogram.
@@ -51,14 +65,52 @@ namespace cuda {
  * @param[in]  numberOfDetectors the number of detectors in the fan beam sinogram
  * @param[in]  numberOfProjections  the number of projections in the fan beam sinogram
  * @param[in]  planeId  the id of the sinogram's plane
+ * @param[in]  numberOfDetectorsPerModule  if greater than zero, the input is expected in the
+ *             module ordered layout of the receiver and is reordered while it is read,
+ *             if zero, the input is already in final detector order
  *
+ * @tparam NumberOfDetectors     compile time number of detectors, zero if numberOfDetectors shall be used
+ * @tparam NumberOfProjections   compile time number of projections, zero if numberOfProjections shall be used
  */
+template <int NumberOfDetectors, int NumberOfProjections>
 __global__ void computeAttenuation(
       const unsigned short* __restrict__ sinogram_in,
-      const float* __restrict__ mask, float* __restrict__ sinogram_out,
+      const float* __restrict__ mask, fanSinogram_type* __restrict__ sinogram_out,
       const float* __restrict__ avgReference, const float* __restrict__ avgDark,
       const float temp, const int numberOfDetectors,
-      const int numberOfProjections, const int planeId);
+      const int numberOfProjections, const int planeId,
+      const int numberOfDetectorsPerModule);
+
+//!   CUDA kernel to compute the attenuation coefficients using precomputed lookup tables
+/**
+ * The attenuation coefficient -log((raw - dark)/(reference - dark)) is rewritten as
+ * log(reference - dark) - log(raw - dark). The first term is fixed for each pixel of a plane,
+ * the second term only depends on the 16 bit raw value and the detector's dark value and is
+ * looked up in a table with 65536 entries. Detectors sharing the same dark value share one table.
+ *
+ * @param[in]  sinogram_in the pointer to the raw data sinogram of size numberOfDetectors*numberOfProjections
+ * @param[in]  mask  the pointer to the mask values, that is multiplied with the attenuation coefficient
+ * @param[out] sinogram_out   pointer to the fan to parallel beam sinogram
+ * @param[in]  logReference   pointer to log(reference - dark) of all planes on device
+ * @param[in]  logRawTables   pointer to the tables containing log(raw - dark) for all raw values
+ * @param[in]  logRawTableIdx pointer to the index of the table used by each detector of each plane
+ * @param[in]  numberOfDetectors the number of detectors in the fan beam sinogram
+ * @param[in]  numberOfProjections  the number of projections in the fan beam sinogram
+ * @param[in]  planeId  the id of the sinogram's plane
+ * @param[in]  numberOfDetectorsPerModule  if greater than zero, the input is expected in the
+ *             module ordered layout of the receiver, see computeAttenuation
+ *
+ * @tparam NumberOfDetectors     compile time number of detectors, zero if numberOfDetectors shall be used
+ * @tparam NumberOfProjections   compile time number of projections, zero if numberOfProjections shall be used
+ */
+template <int NumberOfDetectors, int NumberOfProjections>
+__global__ void computeAttenuationLUT(
+      const unsigned short* __restrict__ sinogram_in,
+      const float* __restrict__ mask, fanSinogram_type* __restrict__ sinogram_out,
+      const float* __restrict__ logReference, const float* __restrict__ logRawTables,
+      const int* __restrict__ logRawTableIdx, const int numberOfDetectors,
+      const int numberOfProjections, const int planeId,
+      const int numberOfDetectorsPerModule);
 
 //! This stage computes the attenuation coefficients in the fan beam sinogram
 /**
@@ -69,9 +121,9 @@ class Attenuation {
 public:
    using input_type = glados::Image<glados::cuda::DeviceMemoryManager<unsigned short, glados::cuda::async_copy_policy>>;
    //!< The input data type that needs to fit the output type of the previous stage
-   using output_type = glados::Image<glados::cuda::DeviceMemoryManager<float, glados::cuda::async_copy_policy>>;
+   using output_type = glados::Image<glados::cuda::DeviceMemoryManager<fanSinogram_type, glados::cuda::async_copy_policy>>;
    //!< The output data type that needs to fit the input type of the following stage
-   using deviceManagerType = glados::cuda::DeviceMemoryManager<float, glados::cuda::async_copy_policy>;
+   using deviceManagerType = glados::cuda::DeviceMemoryManager<fanSinogram_type, glados::cuda::async_copy_policy>;
 public:
 
    //!   Initializes everything, that needs to be done only once
@@ -166,12 +218,29 @@ private:
    template <typename T>
    auto relevantAreaMask(std::vector<T>& mask) -> void;
 
+   //!   Precomputes the lookup tables for the lookup table based attenuation computation
+   /**
+    *    Fills #logReference_ with log(reference - dark) for every pixel of every plane and
+    *    builds one table of log(raw - dark) for all 16 bit raw values per distinct dark value.
+    *    Both terms are clamped like in the direct computation.
+    *
+    *    The dark values are rounded to multiples of #darkQuantization_ first, which changes
+    *    raw - dark by at most half a step. Each table needs 256 KiB of device memory, with the
+    *    default step of one count and dark values below 300 counts (larger ones are interpolated),
+    *    at most about 300 tables (75 MiB) are required instead of one per detector and plane
+    *    (864 tables, 216 MiB, for two planes with 432 detectors).
+    */
+   auto computeLookupTables() -> void;
+
    int numberOfDevices_;         //!<  the number of available CUDA devices in the system
 
    unsigned int chunkSize_{500u}; //!<  defines how much input data is loaded from reference and dark input at once
 
    //configuration values
    int numberOfDetectorModules_; //!<  the number of detector modules
+   int numberOfDetectorsPerModule_{16}; //!<  the number of detectors per detector module
+   DetectorLayout layout_;       //!<  the module structure of the raw data
+   bool fuseReordering_{false};  //!<  if true, the module ordered input is reordered inside the attenuation kernel
    int numberOfDetectors_;       //!<  the number of detectors in the fan beam sinogram
    int numberOfProjections_;     //!<  the number of projections in the fan beam sinogram
    int numberOfPlanes_;          //!<  the number of detector planes
@@ -202,6 +271,14 @@ private:
    std::vector<float> avgDark_;        //!<  stores averaged dark measurement on host
    std::vector<float> avgReference_;   //!<  stores averaged reference measurement on host
 
+   detail::AttenuationMethod attenuationMethod_{detail::AttenuationMethod::direct}; //!<  the method used to compute the attenuation
+
+   //lookup tables on host
+   std::vector<float> logReference_;   //!<  log(reference - dark) for each pixel of each plane
+   std::vector<float> logRawTables_;   //!<  log(raw - dark) for all 16 bit raw values, one table per distinct dark value
+   std::vector<int> logRawTableIdx_;   //!<  the table in #logRawTables_ used by each detector of each plane
+   float darkQuantization_{1.0};       //!<  the dark values are rounded to multiples of this step, before the tables are built
+
 
    //!  Read configuration values from configuration file
    /**
@@ -47,6 +47,17 @@ namespace cuda {
          neareastNeighbor,
          linear
       };
+
+      /**
+      *  This enum represents the arithmetic used during the back projection
+      */
+      enum Precision: short {
+         singlePrecision,  //!< sinogram, weights and accumulation in float
+         fixedPoint        //!< int16 sinogram, 7 bit weights, int32 accumulation
+      };
+
+      //! the interpolation weights of the fixed point back projection sum up to this value
+      const int fixedPointWeightScale = 127;
    }
 
    //! This function performs the back projection operation with linear interpolation
@@ -61,7 +72,12 @@ namespace cuda {
     * @param[in]  numberOfPixels       the number of pixels in the reconstruction grid in one dimension
     * @param[in]  numberOfProjections  the number of projections in the parallel beam sinogram over 180 degrees
     * @param[in]  numberOfDetectors    the number of detectors in the parallel beam sinogram
+    *
+    * @tparam NumberOfPixels        compile time number of pixels, zero if numberOfPixels shall be used
+    * @tparam NumberOfProjections   compile time number of projections, zero if numberOfProjections shall be used
+    * @tparam NumberOfDetectors     compile time number of detectors, zero if numberOfDetectors shall be used
     */
+   template <int NumberOfPixels, int NumberOfProjections, int NumberOfDetectors>
    __global__ void backProjectLinear(const float* const __restrict__ sinogram,
          float* __restrict__ image, const int numberOfPixels,
          const int numberOfProjections, const int numberOfDetectors);
@@ -100,6 +116,66 @@ namespace cuda {
          float* __restrict__ image, const int numberOfPixels,
          const int numberOfProjections, const int numberOfDetectors);
 
+   //! Computes the maximum absolute value of the sinogram
+   /**
+    * The result is stored as the bit pattern of a non-negative float and is written
+    * with atomicMax(). Thus, maxAbs needs to be set to zero before the kernel is launched.
+    *
+    * @param[in]  sinogram    linearized sinogram data
+    * @param[out] maxAbs      the maximum absolute value, reinterpreted as int
+    * @param[in]  size        the number of values in the sinogram
+    */
+   __global__ void computeMaxAbs(const float* const __restrict__ sinogram,
+         int* __restrict__ maxAbs, const int size);
+
+   //! Quantizes the sinogram to signed 16 bit integers using a per-frame scale
+   /**
+    * Each value is multiplied by quantizationMax / maxAbs and rounded to the nearest integer,
+    * such that the largest magnitude maps to quantizationMax.
+    *
+    * @param[in]  sinogram          linearized sinogram data
+    * @param[out] quantized         the quantized sinogram
+    * @param[in]  maxAbs            the maximum absolute value computed by computeMaxAbs()
+    * @param[in]  quantizationMax   the integer value the maximum absolute value is mapped to
+    * @param[in]  size              the number of values in the sinogram
+    */
+   __global__ void quantizeSinogram(const float* const __restrict__ sinogram,
+         short* __restrict__ quantized, const int* const __restrict__ maxAbs,
+         const int quantizationMax, const int size);
+
+   //! This function performs the back projection with linear interpolation in fixed point arithmetic
+   /**
+    * Same geometry as backProjectLinear(), but the sinogram is stored as int16, the interpolation
+    * weights are rounded to 7 bit (summing up to detail::fixedPointWeightScale) and the sum over
+    * all projections is accumulated in a 32 bit integer. On devices with compute capability 6.1
+    * or higher, both products of one projection are computed with a single __dp2a_lo() instruction.
+    *
+    * The quantization step of the sinogram is q = maxAbs / quantizationMax. The error of each
+    * projection's contribution compared to the float path is bounded by
+    * q/2 + |s(a+1) - s(a)| / (2 * 127), i.e. half a quantization step plus the weight rounding error
+    * times the local difference of the two neighboring detector values. After the normalization
+    * with pi / numberOfProjections, the absolute error of a pixel is therefore at most
+    * pi / scale * (maxAbs / (2 * quantizationMax) + maxAbs / 127). As the rounding errors of different
+    * projections are uncorrelated, the observed error is typically smaller by a factor of
+    * sqrt(numberOfProjections).
+    *
+    * @param[in]  sinogram             the quantized sinogram
+    * @param[out] image                the reconstruction grid, in which the reconstructed image is stored
+    * @param[in]  maxAbs               the maximum absolute value used to quantize the sinogram
+    * @param[in]  quantizationMax      the integer value the maximum absolute value was mapped to
+    * @param[in]  numberOfPixels       the number of pixels in the reconstruction grid in one dimension
+    * @param[in]  numberOfProjections  the number of projections in the parallel beam sinogram over 180 degrees
+    * @param[in]  numberOfDetectors    the number of detectors in the parallel beam sinogram
+    *
+    * @tparam NumberOfPixels        compile time number of pixels, zero if numberOfPixels shall be used
+    * @tparam NumberOfProjections   compile time number of projections, zero if numberOfProjections shall be used
+    * @tparam NumberOfDetectors     compile time number of detectors, zero if numberOfDetectors shall be used
+    */
+   template <int NumberOfPixels, int NumberOfProjections, int NumberOfDetectors>
+   __global__ void backProjectFixedPoint(const short* const __restrict__ sinogram,
+         float* __restrict__ image, const int* const __restrict__ maxAbs,
+         const int quantizationMax, const int numberOfPixels,
+         const int numberOfProjections, const int numberOfDetectors);
 
    //!   This stage back projects a parallel beam sinogram and returns the reconstructed image.
    /**
@@ -171,6 +247,9 @@ private:
 
    bool useTextureMemory_;                            //!<  stores, whether texture memory should be used (only nearest neighbour interpolation possible)
 
+   detail::Precision precision_{detail::Precision::singlePrecision}; //!<  the arithmetic used in the back projection
+   int quantizationMax_;                              //!<  the integer value the maximum absolute sinogram value is mapped to in fixed point mode
+
    //! main data processing routine executed in its own thread for each CUDA device, that performs the data processing of this stage
    /**
     * This method takes one sinogram from the queue. It calls the desired back projection
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ *
+ */
+
+
+
+#ifndef DETECTORLAYOUT_H_
+#define DETECTORLAYOUT_H_
+
+#include <string>
+#include <vector>
+
+namespace risa {
+
+//! Describes how the raw data is split into detector modules
+/**
+ * The layout is shared by all stages, that depend on the module structure of the raw data
+ * (Receiver, ReceiverModule, OfflineLoader, Reordering, Attenuation). It is read from the
+ * optional group detectorLayout in the configuration file:
+ *
+ *    detectorLayout = {
+ *       numberOfDetectorsPerModule = 16;
+ *       modules = [0, 1, 2, ...];      //physical module ids in the order of the raw data
+ *       ports = [4000, 4001, ...];     //UDP/TCP port of each module, alternatively basePort
+ *       basePort = 4000;
+ *    };
+ *
+ * If the group or one of its entries is missing, the values are derived from the flat
+ * configuration values numberOfDetectorModules and numberOfDetectorsPerModule, the modules
+ * are used in their physical order and listen to port 4000 + module id. Listing only a subset
+ * of the modules allows to process a partial detector ring.
+ *
+ * The layout also decides, in which order the raw data enters the attenuation stage: module ordered,
+ * if the reordering is fused into the attenuation kernel (fuseReordering), or in detector order
+ * from the reordering stage otherwise.
+ */
+class DetectorLayout {
+public:
+   //! Reads the layout from the configuration file
+   /**
+    * @param[in]  configFile  path to configuration file
+    *
+    * @retval  true  configuration options were read successfully
+    * @retval  false configuration options could not be read successfully
+    */
+   auto readConfig(const std::string& configFile) -> bool;
+
+   //! the number of detector modules contained in the raw data
+   auto numberOfModules() const -> int { return modules_.size(); }
+   //! the number of detectors of one detector module
+   auto numberOfDetectorsPerModule() const -> int { return numberOfDetectorsPerModule_; }
+   //! the number of detectors in the raw data
+   auto numberOfDetectors() const -> int { return numberOfModules() * numberOfDetectorsPerModule_; }
+   //! the physical id of the module stored at position index in the raw data
+   auto module(int index) const -> int { return modules_[index]; }
+   //! the port, at which the module stored at position index in the raw data is received
+   auto port(int index) const -> int { return ports_[index]; }
+   //! true, if the attenuation stage receives the module ordered raw data and reorders it itself
+   auto fuseReordering() const -> bool { return fuseReordering_; }
+
+private:
+   int numberOfDetectorsPerModule_{16};
+   bool fuseReordering_{false};
+   std::vector<int> modules_;
+   std::vector<int> ports_;
+};
+
+}
+
+#endif /* DETECTORLAYOUT_H_ */
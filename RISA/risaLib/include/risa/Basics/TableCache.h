@@ -0,0 +1,151 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ *
+ */
+
+
+#ifndef TABLECACHE_H_
+#define TABLECACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace risa {
+
+//! Persistent on-disk cache for lookup tables that only depend on configuration values
+/**
+ * The tables are stored in one binary file per stage in the cache directory. The file name
+ * contains the hash of all configuration values the tables depend on, so a change of the
+ * geometry automatically leads to a new file. On a hit, the file is mapped into memory and
+ * the tables can be used without recomputation.
+ *
+ * File layout: header, table directory (offset, size in bytes and element size of each table),
+ * table data aligned to 64 bytes.
+ */
+class TableCache {
+public:
+   //! Computes the key of a cache entry from the configuration values (64 bit FNV-1a)
+   class Key {
+   public:
+      //! Adds a configuration value to the key
+      template<typename T>
+      auto add(const T& value) -> Key& {
+         static_assert(std::is_arithmetic<T>::value, "only arithmetic configuration values can be hashed");
+         return addBytes(&value, sizeof(T));
+      }
+
+      auto value() const -> std::uint64_t { return hash_; }
+
+   private:
+      auto addBytes(const void* data, std::size_t size) -> Key&;
+
+      std::uint64_t hash_{14695981039346656037ull};
+   };
+
+   //! Creates the cache entry description, no file is accessed
+   /**
+    * @param[in]  directory   the cache directory, caching is disabled if empty
+    * @param[in]  name        the name of the stage the tables belong to
+    * @param[in]  key         the hash of the configuration values
+    */
+   TableCache(const std::string& directory, const std::string& name, const Key& key);
+
+   TableCache(const TableCache&) = delete;
+   auto operator=(const TableCache&) -> TableCache& = delete;
+
+   //! Unmaps the cache file
+   ~TableCache();
+
+   //! Maps the cache file into memory and validates its header
+   /**
+    * @retval  true  the cache file exists and matches the key and the file format version
+    * @retval  false the tables need to be computed
+    */
+   auto load() -> bool;
+
+   //! Returns a pointer to the mapped table at position index
+   /**
+    * @param[in]  index    the position of the table in the order it was added before storing
+    * @param[in]  size     the expected number of elements
+    * @return     pointer to the table data, nullptr if the table does not match
+    */
+   template<typename T>
+   auto table(std::size_t index, std::size_t size) const -> const T* {
+      return static_cast<const T*>(table(index, size, sizeof(T)));
+   }
+
+   //! Copies the mapped table at position index into a std::vector
+   /**
+    * @retval  true  the table was copied
+    * @retval  false the table does not match, the vector is unchanged
+    */
+   template<typename T>
+   auto copy(std::size_t index, std::vector<T>& values) const -> bool {
+      auto data = table<T>(index, values.size());
+      if(data == nullptr)
+         return false;
+      values.assign(data, data + values.size());
+      return true;
+   }
+
+   //! Adds a table, that is written to disk by store()
+   /**
+    * The table is not copied, it needs to stay alive until store() is called.
+    */
+   template<typename T>
+   auto add(const std::vector<T>& values) -> void {
+      static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable tables can be cached");
+      tables_.push_back(Table{values.data(), values.size() * sizeof(T), sizeof(T)});
+   }
+
+   //! Writes all added tables to the cache file
+   /**
+    * The file is written under a temporary name and renamed afterwards, so that concurrently
+    * starting processes never map an incomplete file. Failures are logged, but not fatal.
+    */
+   auto store() -> void;
+
+   auto enabled() const -> bool { return !directory_.empty(); }
+
+private:
+   auto table(std::size_t index, std::size_t size, std::size_t elementSize) const -> const void*;
+
+   struct Table {
+      const void* data;
+      std::size_t bytes;
+      std::size_t elementSize;
+   };
+
+   std::string directory_;       //!<  the cache directory
+   std::string fileName_;        //!<  the path of the cache file
+   std::uint64_t key_;           //!<  the hash of the configuration values
+   std::vector<Table> tables_;   //!<  the tables to store
+
+   void* mapping_{nullptr};      //!<  the mapped cache file
+   std::size_t mappingSize_{0u}; //!<  the size of the mapped cache file
+};
+
+}
+
+#endif /* TABLECACHE_H_ */
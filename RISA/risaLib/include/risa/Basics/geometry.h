@@ -0,0 +1,83 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ *
+ */
+
+#ifndef GEOMETRY_H_
+#define GEOMETRY_H_
+
+namespace risa {
+namespace cuda {
+
+//! Contains the data set dimensions of the ROFEX production setup, for which specialized kernels are compiled
+/**
+ * The CUDA kernels of the performance critical stages are templates, that take the data set dimensions
+ * as template parameters. If a template parameter is zero, the kernel uses the runtime value that
+ * was passed as function argument. Otherwise, the compile time value is used, which allows the compiler
+ * to fully unroll the loops and to compute all index strides at compile time.
+ *
+ * Each stage checks once at startup, whether the configured geometry matches the values in this
+ * namespace and picks the instantiation to launch with selectKernel(): the specialized kernel, if so,
+ * else the generic one.
+ */
+namespace geometry {
+
+constexpr int numberOfFanDetectors = 432;          //!<  the number of detectors in the fan beam sinogram
+constexpr int numberOfFanProjections = 500;        //!<  the number of projections in the fan beam sinogram
+constexpr int numberOfDetectorsPerModule = 16;     //!<  the number of detectors of one detector module
+constexpr int numberOfParallelDetectors = 256;     //!<  the number of detectors in the parallel beam sinogram
+constexpr int numberOfParallelProjections = 512;   //!<  the number of projections in the parallel beam sinogram over 180 degrees
+constexpr int numberOfPixels = 256;                //!<  the number of pixels in the reconstruction grid in one dimension
+constexpr int numberOfPaddedDetectors = 512;       //!<  the zero padded length of the projections in the filter stage
+
+//! Returns the compile time value, if specified, or the runtime value otherwise
+/**
+ * @param[in]  value  the runtime value
+ *
+ * @return  CompileTimeValue if it is greater than zero, value otherwise
+ */
+template <int CompileTimeValue>
+__host__ __device__ __forceinline__ constexpr auto select(const int value) -> int {
+   return CompileTimeValue > 0 ? CompileTimeValue : value;
+}
+
+//! Returns the kernel instantiation, that shall be launched for the configured geometry
+/**
+ * Both instantiations of a kernel template share the same signature, so the call site can launch
+ * the returned pointer once with its arguments, regardless of which instantiation was selected.
+ *
+ * @param[in]  matches      true, if the configured geometry equals the production geometry
+ * @param[in]  specialized  the instantiation with the compile time dimensions of this namespace
+ * @param[in]  generic      the instantiation, that reads all dimensions at runtime
+ *
+ * @return  specialized if matches is true, generic otherwise
+ */
+template <typename Kernel>
+inline auto selectKernel(const bool matches, Kernel specialized, Kernel generic) -> Kernel {
+   return matches ? specialized : generic;
+}
+
+}
+
+}
+}
+
+#endif /* GEOMETRY_H_ */
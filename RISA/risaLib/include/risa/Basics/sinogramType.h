@@ -0,0 +1,74 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ *
+ */
+
+#ifndef SINOGRAMTYPE_H_
+#define SINOGRAMTYPE_H_
+
+#include <cuda_fp16.h>
+
+namespace risa {
+namespace cuda {
+
+//! The data type in which the attenuated fan beam sinogram is stored between the Attenuation and the Fan2Para stage
+/**
+ * If RISA is built with RISA_HALF_SINOGRAMS, the fan beam sinogram is stored in 16 bit floating point
+ * format. This halves the memory bandwidth needed for writing it in the attenuation kernel and reading
+ * it in the fan to parallel beam interpolation kernel as well as the memory pool footprint. All
+ * arithmetic is still done in single precision, the conversion is performed when the values are
+ * stored and loaded. With a 10 bit mantissa, the relative rounding error is at most 2^-11.
+ */
+#ifdef RISA_HALF_SINOGRAMS
+using fanSinogram_type = __half;
+#else
+using fanSinogram_type = float;
+#endif
+
+#ifdef __CUDACC__
+//! Converts a single precision value to the sinogram storage type
+template <typename T>
+__device__ __forceinline__ auto fromFloat(const float value) -> T;
+
+template <>
+__device__ __forceinline__ auto fromFloat<float>(const float value) -> float {
+   return value;
+}
+
+template <>
+__device__ __forceinline__ auto fromFloat<__half>(const float value) -> __half {
+   return __float2half(value);
+}
+
+//! Converts a value of the sinogram storage type to single precision
+__device__ __forceinline__ auto toFloat(const float value) -> float {
+   return value;
+}
+
+__device__ __forceinline__ auto toFloat(const __half value) -> float {
+   return __half2float(value);
+}
+#endif
+
+}
+}
+
+#endif /* SINOGRAMTYPE_H_ */
@@ -85,6 +85,17 @@ public:
 	   return false;
    }
 
+   //! Returns the number of elements of the configuration value list identified by the identifier-string
+   /**
+    * @param[in]  identifier  the string used to identify the desired list in the configuration file
+    * @return  the number of elements, zero if the list does not exist
+    */
+   int lookupLength(const std::string& identifier) {
+      if(!cfg.exists(identifier.c_str()))
+         return 0;
+      return cfg.lookup(identifier.c_str()).getLength();
+   }
+
 private:
    libconfig::Config cfg;
 };
@@ -41,6 +41,95 @@
 namespace risa {
 namespace cuda {
 
+//!   CUDA kernel to compute the variation metric of each detector
+/**
+ * The metric is the total variation of the detector's values over the projections multiplied
+ * with the squared range of the values. blockDim.x detectors are processed per block, the
+ * projections are distributed over blockDim.y threads and reduced in shared memory.
+ *
+ * @param[in]  sinogram   the raw data sinogram of size numberOfDetectors*numberOfProjections
+ * @param[out] variation  the variation metric of each detector
+ * @param[in]  numberOfDetectors the number of detectors in the fan beam sinogram
+ * @param[in]  numberOfProjections  the number of projections in the fan beam sinogram
+ */
+__global__ void detectorVariation(const unsigned short* __restrict__ sinogram, float* __restrict__ variation,
+      const int numberOfDetectors, const int numberOfProjections);
+
+//!   CUDA kernel to update the running statistics of the variation metric with the current sinogram
+/**
+ * Mean and sum of squared deviations are updated with Welford's algorithm. Additionally, the
+ * working detectors are checked for drift: a value deviating more than driftThreshold standard
+ * deviations from the statistics of the last evaluation of the defect mask increments drift.
+ *
+ * @param[in]  variation  the variation metric of each detector in the current sinogram
+ * @param[in,out] mean    the running mean of the variation metric
+ * @param[in,out] m2      the running sum of squared deviations from the mean
+ * @param[in]  referenceMean  the mean at the last evaluation of the defect mask
+ * @param[in]  referenceStd   the standard deviation at the last evaluation of the defect mask
+ * @param[in]  defects    the current defect flags, defect detectors are not checked for drift
+ * @param[out] drift      incremented for each drifting detector
+ * @param[in]  count      the number of sinograms in the statistics including the current one
+ * @param[in]  numberOfDetectors the number of detectors in the fan beam sinogram
+ * @param[in]  driftThreshold the allowed deviation in standard deviations, zero disables the check
+ */
+__global__ void updateVariationStatistics(const float* __restrict__ variation, float* __restrict__ mean,
+      float* __restrict__ m2, const float* __restrict__ referenceMean, const float* __restrict__ referenceStd,
+      const int* __restrict__ defects, int* __restrict__ drift, const int count,
+      const int numberOfDetectors, const float driftThreshold);
+
+//!   CUDA kernel to store the running statistics as reference and to restart them
+/**
+ * @param[in,out] mean    the running mean of the variation metric, reset to zero
+ * @param[in,out] m2      the running sum of squared deviations, reset to zero
+ * @param[out] referenceMean  the mean used for the drift check until the next evaluation
+ * @param[out] referenceStd   the standard deviation used for the drift check until the next evaluation
+ * @param[in]  count      the number of sinograms in the statistics
+ * @param[in]  numberOfDetectors the number of detectors in the fan beam sinogram
+ */
+__global__ void restartVariationStatistics(float* __restrict__ mean, float* __restrict__ m2,
+      float* __restrict__ referenceMean, float* __restrict__ referenceStd, const int count,
+      const int numberOfDetectors);
+
+//!   CUDA kernel to mark the defect detectors
+/**
+ * Each thread compares the variation metric of one detector to the filtered variation of its
+ * neighbours within the same half of the detector ring. Dead detectors are marked, flickering
+ * detectors are marked together with two neighbours on each side.
+ *
+ * @param[in]  variation  the variation metric of each detector
+ * @param[in]  filterFunction the normalized weights of the neighbours
+ * @param[out] defects    one flag per detector, needs to be zeroed before
+ * @param[in]  numberOfDetectors the number of detectors in the fan beam sinogram
+ * @param[in]  threshMin  detectors below threshMin times the filtered variation are dead
+ * @param[in]  threshMax  detectors above threshMax times the filtered variation are flickering
+ */
+__global__ void markDefectDetectors(const float* __restrict__ variation, const float* __restrict__ filterFunction,
+      int* __restrict__ defects, const int numberOfDetectors, const float threshMin, const float threshMax);
+
+//!   CUDA kernel to find the working neighbours of each defect detector
+/**
+ * @param[in]  defects    one flag per detector
+ * @param[out] leftDistance   the distance to the next working detector on the left, zero for working detectors
+ * @param[out] rightDistance  the distance to the next working detector on the right
+ * @param[in]  numberOfDetectors the number of detectors in the fan beam sinogram
+ */
+__global__ void findWorkingNeighbours(const int* __restrict__ defects, int* __restrict__ leftDistance,
+      int* __restrict__ rightDistance, const int numberOfDetectors);
+
+//!   CUDA kernel to interpolate the defect detectors in place
+/**
+ * The values of defect detectors are linearly interpolated between the next working detectors.
+ * Only values of working detectors are read, so the sinogram can be updated in place.
+ *
+ * @param[in,out] sinogram   the raw data sinogram of size numberOfDetectors*numberOfProjections
+ * @param[in]  leftDistance  the distance to the next working detector on the left, zero for working detectors
+ * @param[in]  rightDistance the distance to the next working detector on the right
+ * @param[in]  numberOfDetectors the number of detectors in the fan beam sinogram
+ * @param[in]  numberOfProjections  the number of projections in the fan beam sinogram
+ */
+__global__ void interpolateDefects(unsigned short* __restrict__ sinogram, const int* __restrict__ leftDistance,
+      const int* __restrict__ rightDistance, const int numberOfDetectors, const int numberOfProjections);
+
 //!   This stage interpolates the defect detectors in the raw data sinogram.
 class DetectorInterpolation {
 public:
@@ -88,13 +177,15 @@ private:
 
    std::map<int, std::thread> processorThreads_;      //!<  stores the processor()-threads
    std::map<int, cudaStream_t> streams_;              //!<  stores the cudaStreams that are created once
-   std::map<int, unsigned int> memoryPoolIdxs_;       //!<  stores the indeces received when regisitering in MemoryPool
 
    //! main data processing routine executed in its own thread for each CUDA device, that performs the data processing of this stage
    /**
-    * This method takes one sinogram from the input queue #sinograms_. So far, the detector interpolation is
-    * performed on the host. Thus, the data is transfered from host to device, the raw data sinogram
-    * is interpolated and afterwards, transfered from device to host.
+    * This method takes one sinogram from the input queue #sinograms_. The defect detectors are detected
+    * and interpolated in place on the device, the sinogram does not leave the device.
+    *
+    * Per plane, the variation metric of each detector is accumulated over the sinograms. The defect mask
+    * is evaluated on the mean metric every #defectDetectionInterval_ sinograms or as soon as a working
+    * detector drifts. In between, only the cached defect list is applied.
     *
     * @param[in]  deviceID specifies on which CUDA device to execute the device functions
     */
@@ -104,11 +195,12 @@ private:
 
    unsigned int numberOfDetectors_;    //!<  the number of detectors in the fan beam sinogram
    unsigned int numberOfProjections_;  //!<  the number of projections in the fan beam sinogram
+   int numberOfPlanes_;                //!<  the number of detector planes
+   int defectDetectionInterval_{1};    //!<  the number of sinograms per plane after which the defect mask is evaluated
+   float defectDriftThreshold_{0.f};   //!<  the deviation in standard deviations, that triggers an evaluation, zero disables it
 
-   double threshMin_;          //!<
-   double threshMax_;          //!<
-
-   int memPoolSize_;          //!< specifies, how many elements are allocated by memory pool
+   double threshMin_;          //!<  detectors below threshMin times the filtered variation of the neighbours are dead
+   double threshMax_;          //!<  detectors above threshMax times the filtered variation of the neighbours are flickering
 
    std::set<int> defects_;
 
@@ -24,6 +24,9 @@
 #ifndef FAN2PARA_H_
 #define FAN2PARA_H_
 
+#include <risa/Basics/sinogramType.h>
+#include <risa/Basics/TableCache.h>
+
 #include <glados/Image.h>
 #include <glados/cuda/DeviceMemoryManager.h>
 #include <glados/Queue.h>
@@ -34,10 +37,23 @@
 #include <map>
 #include <thread>
 #include <array>
+#include <cstddef>
+#include <string>
 
 namespace risa {
 namespace cuda {
 
+namespace detail{
+   /**
+   *  This enum represents the method used to apply
+   *  the fan to parallel beam rebinning
+   */
+   enum RebinningMethod: short {
+      hashTable,     //!< one thread per parallel bin evaluates the precomputed angles and indices
+      sparseMatrix   //!< the rebinning is applied as precomputed sparse matrix in CSR format
+   };
+}
+
 //! collects all parameters that are needed in the fan to parallel beam interpolation kernel
 struct parameters {
    int numberOfPlanes_;
@@ -83,7 +99,7 @@ struct hashTable {
  */
 class Fan2Para {
 public:
-   using input_type = glados::Image<glados::cuda::DeviceMemoryManager<float, glados::cuda::async_copy_policy>>;
+   using input_type = glados::Image<glados::cuda::DeviceMemoryManager<fanSinogram_type, glados::cuda::async_copy_policy>>;
    //!< The input data type that needs to fit the output type of the previous stage
    using output_type = glados::Image<glados::cuda::DeviceMemoryManager<float, glados::cuda::async_copy_policy>>;
    //!< The output data type that needs to fit the input type of the following stage
@@ -140,20 +156,14 @@ private:
    std::array<float, 2> rTarget_;
    std::array<char, 2> detectorInter_;
 
-   //Hash Table on device
-   std::map<int, glados::cuda::device_ptr<float, glados::cuda::async_copy_policy>>
-         theta_d_, gamma_d_, s_d_, alphaCircle_d_;
-   std::map<int, glados::cuda::device_ptr<int, glados::cuda::async_copy_policy>>
-         thetaAfterRay1_d_, thetaAfterRay2_d_, thetaBeforeRay1_d_,
-         thetaBeforeRay2_d_, gammaAfterRay1_d_, gammaAfterRay2_d_,
-         gammaBeforeRay1_d_, gammaBeforeRay2_d_;
-   std::map<int, glados::cuda::device_ptr<float, glados::cuda::async_copy_policy>>
-         gammaGoalRay1_d_, gammaGoalRay2_d_, thetaGoalRay1_d_, thetaGoalRay2_d_;
-   std::map<int, glados::cuda::device_ptr<int, glados::cuda::async_copy_policy>>
-         ray1_d_, ray2_d_;
+   //packed Hash Table, one contiguous block per plane, see packedTableLayout
+   std::vector<char> packedTable_;     //!<  the packed hash table of all planes on the host
+   std::size_t packedPlaneSize_;       //!<  the size of the packed hash table of one plane in bytes
+   std::map<int, glados::cuda::device_ptr<char, glados::cuda::async_copy_policy>> packedTable_d_;
 
    //Hash Table on host
    std::vector<float> theta_, gamma_, s_, alphaCircle_;
+   int thetaMinIdx_;    //!<  index of the smallest source position, theta_ is sorted ascending starting here
    std::vector<int> thetaAfterRay1_, thetaAfterRay2_, thetaBeforeRay1_,
          thetaBeforeRay2_, gammaAfterRay1_, gammaAfterRay2_, gammaBeforeRay1_,
          gammaBeforeRay2_;
@@ -167,6 +177,17 @@ private:
 
    int memPoolSize_;    //!<  the number of elements the memory pool allocates
 
+   std::string tableCacheDirectory_;   //!<  the directory of the lookup table cache, no caching if empty
+
+   detail::RebinningMethod rebinningMethod_{detail::RebinningMethod::hashTable}; //!<  the method used to apply the rebinning
+
+   //Rebinning matrix in CSR format, one block of rows per plane, column indices refer to the plane's fan beam sinogram
+   std::vector<int> csrRowPtr_;     //!<  the start of each row, size numberOfPlanes * rows + 1
+   std::vector<int> csrColInd_;     //!<  the column index of each nonzero
+   std::vector<float> csrValues_;   //!<  the interpolation weight of each nonzero
+   std::map<int, glados::cuda::device_ptr<int, glados::cuda::async_copy_policy>> csrRowPtr_d_, csrColInd_d_;
+   std::map<int, glados::cuda::device_ptr<float, glados::cuda::async_copy_policy>> csrValues_d_;
+
    //! main data processing routine executed in its own thread for each CUDA device, that performs the data processing of this stage
    /**
     * This method takes one sinogram from the queue. It calls the fan to parallel beam interpolation
@@ -181,9 +202,55 @@ private:
    //!   The main function for computing the hash table for the fan to parallel beam rebinning process
    auto computeFan2ParaTransp() -> void;
 
+   //! Allocates the host memory for the hash table and sets all entries to zero
+   auto allocateFan2ParaTransp() -> void;
+
+   //! Reads the hash table from the table cache
+   /**
+    * @param[in]  cache the loaded cache entry
+    * @retval  true  the hash table was read successfully
+    * @retval  false the cache entry does not match, the hash table needs to be computed
+    */
+   auto loadFan2ParaTransp(const TableCache& cache) -> bool;
+
+   //! Writes the hash table to the table cache
+   auto storeFan2ParaTransp(TableCache& cache) -> void;
+
    auto computeAngles(int i, int j, unsigned int ind, int k, float L,
          float kappa) -> void;
 
+   //! Binary search for the first source position not smaller than thetaGoal
+   /**
+    * @param[in]  thetaGoal   the source position of the ray
+    * @return     the index of the next source position, #thetaMinIdx_ (the smallest source position)
+    *             if thetaGoal exceeds all source positions
+    */
+   auto findTheta(float thetaGoal) const -> int;
+
+   //! Binary search for the first detector position not smaller than gammaGoal
+   /**
+    * @param[in]  gammaGoal   the detector position of the ray
+    * @return     the index of the next detector position, 0 if gammaGoal exceeds all detector positions
+    */
+   auto findGamma(float gammaGoal) const -> int;
+
+   //! Packs the hash table into one contiguous block per plane
+   /**
+    * Indices are stored as 16 bit values, the validity of the rays as bit mask and the
+    * bilinear interpolation weights are precomputed from the goal angles, so that the
+    * interpolation kernel only needs four weighted loads per ray.
+    */
+   auto computePackedTable() -> void;
+
+   //! Expresses the rebinning including the conversion to 180 degrees as sparse matrix
+   /**
+    * Each bin of the 360 degree parallel beam sinogram is the weighted average of at most two
+    * bilinear interpolations (ray 1 and ray 2) in the fan beam sinogram, i.e. it has at most 8
+    * nonzeros. Two of these bins are averaged into one bin of the 180 degree sinogram. The weights
+    * are taken from the packed hash table, duplicate columns are merged.
+    */
+   auto computeSparseMatrix() -> void;
+
    //! Transfers the hash table from host to the specified CUDA device.
    /**
     * @param[in]  deviceID specifies on which CUDA device to transfer the hash table
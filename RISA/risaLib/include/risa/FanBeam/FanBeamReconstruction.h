@@ -0,0 +1,207 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ *
+ */
+
+#ifndef FANBEAMRECONSTRUCTION_H_
+#define FANBEAMRECONSTRUCTION_H_
+
+#include <risa/Basics/sinogramType.h>
+
+#include <glados/Image.h>
+#include <glados/cuda/DeviceMemoryManager.h>
+#include <glados/Queue.h>
+#include <glados/cuda/Memory.h>
+
+#include <map>
+#include <thread>
+#include <array>
+#include <vector>
+
+namespace risa {
+namespace cuda {
+
+//! Weights and ramp filters the fan beam sinogram along the fan angle
+/**
+ * One CUDA block processes one fan beam projection. The weighted projection and the fan angles
+ * of all detectors are loaded into shared memory. As the fan angles of the ring detector are not
+ * equally spaced when seen from the source, the convolution with the fan beam ramp kernel
+ * g(psi) = 0.5 * (psi / sin(psi))^2 * h(psi) is computed directly in the spatial domain, using the
+ * band limited ramp filter h with the mean angular sampling distance delta.
+ *
+ * @param[in]  sinogram             the attenuated fan beam sinogram
+ * @param[out] filtered             the filtered fan beam sinogram
+ * @param[in]  fanAngles            the fan angle of each detector seen from the source of each projection
+ * @param[in]  weights              the precomputed weight of each sample (cosine, redundancy and quadrature weight)
+ * @param[in]  numberOfDetectors    the number of detectors in the fan beam sinogram
+ * @param[in]  delta                the mean angular sampling distance divided by the cutoff fraction
+ */
+__global__ void filterFanBeam(const fanSinogram_type* __restrict__ sinogram,
+      float* __restrict__ filtered, const float* __restrict__ fanAngles,
+      const float* __restrict__ weights, const int numberOfDetectors, const float delta);
+
+//! Back projects the filtered fan beam sinogram directly with the ROFEX source/detector geometry
+/**
+ * Pixel driven back projection: for each projection, the ray from the source position through the
+ * pixel center is intersected with the detector ring. The filtered projection is linearly interpolated
+ * at this position and weighted with the source angle increment divided by the squared
+ * distance between source and pixel.
+ *
+ * @param[in]  filtered             the filtered fan beam sinogram
+ * @param[out] image                the reconstruction grid, in which the reconstructed image is stored
+ * @param[in]  sources              the source position of each projection in the reconstruction plane
+ * @param[in]  sourceIncrements     the source angle increment of each projection, zero if the projection is not used
+ * @param[in]  numberOfPixels       the number of pixels in the reconstruction grid in one dimension
+ * @param[in]  numberOfProjections  the number of projections in the fan beam sinogram
+ * @param[in]  numberOfDetectors    the number of detectors in the fan beam sinogram
+ * @param[in]  rDetector            the radius of the detector ring
+ * @param[in]  pixelSize            the edge length of one pixel
+ * @param[in]  centerX              the x-coordinate of the image center
+ * @param[in]  centerY              the y-coordinate of the image center
+ * @param[in]  cosRotation          cosine of the rotation offset of the reconstructed image
+ * @param[in]  sinRotation          sine of the rotation offset of the reconstructed image
+ * @param[in]  outputScale          scales the result to the units of the parallel beam reconstruction
+ */
+__global__ void backProjectFanBeam(const float* __restrict__ filtered,
+      float* __restrict__ image, const float2* __restrict__ sources,
+      const float* __restrict__ sourceIncrements, const int numberOfPixels,
+      const int numberOfProjections, const int numberOfDetectors,
+      const float rDetector, const float pixelSize, const float centerX,
+      const float centerY, const float cosRotation, const float sinRotation,
+      const float outputScale);
+
+//!   This stage reconstructs the image directly from the fan beam sinogram.
+/**
+ * This class represents an alternative to the stages Fan2Para, Filter and Backprojection. Instead of
+ * rebinning the fan beam sinogram to parallel beam geometry, the fan beam sinogram is weighted, ramp
+ * filtered along the fan angle and back projected directly using the ROFEX geometry. This avoids the
+ * interpolation blur of the rebinning step and one full resampling pass per frame.
+ *
+ * Source positions are obtained by inverting the mapping of the tilted target ring onto the detector
+ * plane (see ellipse_kreis_uwe()). Rays that are measured twice within the covered source angle are
+ * weighted with one half, analogous to the averaging of both rays in Fan2Para.
+ */
+class FanBeamReconstruction {
+public:
+   using input_type = glados::Image<glados::cuda::DeviceMemoryManager<fanSinogram_type, glados::cuda::async_copy_policy>>;
+   //!< The input data type that needs to fit the output type of the previous stage
+   using output_type = glados::Image<glados::cuda::DeviceMemoryManager<float, glados::cuda::async_copy_policy>>;
+   //!< The output data type that needs to fit the input type of the following stage
+   using deviceManagerType = glados::cuda::DeviceMemoryManager<float, glados::cuda::async_copy_policy>;
+
+public:
+
+   //!   Initializes everything, that needs to be done only once
+   /**
+    *
+    *    Computes the geometry tables and runs as many processor-thread as CUDA devices are available in
+    *    the system. Allocates memory using the MemoryPool for all CUDA devices.
+    *
+    *    @param[in]  configFile  path to configuration file
+    */
+   FanBeamReconstruction(const std::string& configFile);
+
+   //!   Destroys everything that is not destroyed automatically
+   /**
+    *    Tells MemoryPool to free the allocated memory.
+    *    Destroys the cudaStreams.
+    */
+   ~FanBeamReconstruction();
+
+   //! Pushes the fan beam sinogram to the processor-threads
+   /**
+    *    @param[in]  sinogram   input data that arrived from previous stage
+    */
+   auto process(input_type&& sinogram) -> void;
+
+   //! Takes one image from the output queue #results_ and transfers it to the neighbored stage.
+   /**
+    *    @return  the oldest reconstructed image in the output queue #results_
+    */
+   auto wait() -> output_type;
+
+private:
+   std::map<int, glados::Queue<input_type>> sinograms_; //!<  one separate input queue for each available CUDA device
+   glados::Queue<output_type> results_;                 //!<  the output queue in which the reconstructed images are stored
+
+   std::map<int, std::thread> processorThreads_;      //!<  stores the processor()-threads
+   std::map<int, cudaStream_t> streams_;              //!<  stores the cudaStreams that are created once
+   std::vector<unsigned int> memoryPoolIdxs_;         //!<  stores the indeces received when regisitering in MemoryPool
+
+   int numberOfDevices_;                              //!<  the number of available CUDA devices in the system
+
+   //configuration parameters
+   int numberOfFanDetectors_;                         //!<  the number of detectors in the fan beam sinogram
+   int numberOfFanProjections_;                       //!<  the number of projections in the fan beam sinogram
+   int numberOfParallelDetectors_;                    //!<  the number of detectors of the parallel beam path, defines the output units
+   int numberOfPixels_;                               //!<  the number of pixels in the reconstruction grid in one dimension
+   int numberOfPlanes_;                               //!<  the number of planes
+   float sourceOffset_;                               //!<  the angular offset of the source positions in degree
+   float rDetector_;                                  //!<  the radius of the detector ring
+   float imageCenterX_;                               //!<  the x-coordinate of the image center
+   float imageCenterY_;                               //!<  the y-coordinate of the image center
+   float imageWidth_;                                 //!<  the edge length of the reconstructed image
+   float rotationOffset_;                             //!<  the rotation of the reconstructed image in degree
+   float cutoffFraction_;                             //!<  the cutoff frequency of the ramp filter as fraction of the Nyquist frequency
+   std::array<float, 2> deltaX_;                      //!<  the x-offset of the target ring for each plane
+   std::array<float, 2> deltaZ_;                      //!<  the z-offset of the target ring for each plane
+   std::array<float, 2> sourceAngle_;                 //!<  the covered source angle in degree for each plane
+   std::array<float, 2> rTarget_;                     //!<  the radius of the target ring for each plane
+
+   //geometry tables on host, concatenated for all planes
+   std::vector<float> fanAngles_;                     //!<  the fan angle of each detector for each projection
+   std::vector<float> weights_;                       //!<  the weight of each sample applied before filtering
+   std::vector<float2> sources_;                      //!<  the source position of each projection
+   std::vector<float> sourceIncrements_;              //!<  the source angle increment of each projection
+   std::array<float, 2> delta_;                       //!<  the mean angular sampling distance for each plane
+
+   //kernel execution coniguration
+   int blockSize2D_;                                  //!<  2D block size of the back projection kernel
+   int memPoolSize_;                                  //!<  specifies, how many elements are allocated by memory pool
+
+   //! main data processing routine executed in its own thread for each CUDA device, that performs the data processing of this stage
+   /**
+    * This method takes one sinogram from the queue, filters it and back projects it
+    * in its own stream. The reconstructed image is pushed into the output queue.
+    *
+    * @param[in]  deviceID specifies on which CUDA device to execute the device functions
+    */
+   auto processor(const int deviceID) -> void;
+
+   //! Computes the source positions, fan angles and weights for all planes
+   auto computeGeometry() -> void;
+
+   //!  Read configuration values from configuration file
+   /**
+    * All values needed for setting up the class are read from the config file
+    * in this function.
+    *
+    * @param[in] configFile path to config file
+    *
+    * @retval  true  configuration options were read successfully
+    * @retval  false configuration options could not be read successfully
+    */
+   auto readConfig(const std::string& configFile) -> bool;
+};
+}
+}
+
+#endif /* FANBEAMRECONSTRUCTION_H_ */
@@ -33,6 +33,7 @@
 
 #include <cufft.h>
 
+#include <functional>
 #include <map>
 #include <thread>
 
@@ -51,6 +52,16 @@ namespace cuda {
          hamming,
          hanning
       };
+
+      /**
+      *  This enum represents the implementation
+      *  used to apply the filter function
+      */
+      enum FilterImplementation: short {
+         automatic,     //!< the faster implementation is measured at startup
+         fft,           //!< multiplication in frequency domain
+         convolution    //!< convolution in spatial domain
+      };
    }
 
 //! This stage filters the projections in the parallel beam sinogram with a precomputed filter function.
@@ -100,6 +111,9 @@ private:
 	int numberOfDetectors_;                              //!<  the number of detectors in the parallel beam sinogramm over 180 degrees
 	int numberOfPixels_;                                 //!<  the number of pixels in the reconstruction grid in one dimension
 
+	float paddingFactor_;                                //!<  the projections are zero padded to at least this multiple of their length
+	int numberOfPaddedDetectors_;                        //!<  the length of the zero padded projections, the FFT length
+
 	detail::FilterType filterType_;                      //!<  the filter type that shall be used; standarf filter type is the ramp filter.
 	float cutoffFraction_;                               //!<  the fraction at which the filter function is cropped and set to zero.
 
@@ -114,6 +128,9 @@ private:
 	std::map<int, cudaStream_t> streams_;       //!<  stores the cudaStreams that are created once
 
 	std::vector<float> filter_;                 //!<  stores the values of the filter function
+	std::vector<float> convolutionKernel_;      //!<  stores the filter function in spatial domain
+
+	detail::FilterImplementation filterImplementation_;   //!<  the implementation used to apply the filter function
 
    //! main data processing routine executed in its own thread for each CUDA device, that performs the data processing of this stage
    /**
@@ -144,8 +161,25 @@ private:
     */
 	auto readConfig(const std::string& configFile) -> bool;
 
-   //!<  This function computes the requested filter function once on the host
+   //!<  This function computes the requested filter function once on the host for the zero padded projections
 	auto designFilter() -> void;
+
+   //!<  This function computes the spatial domain filter kernel from the filter function
+   /**
+    * The kernel is the inverse transform of the filter function, so that both
+    * implementations give the same result.
+    */
+	auto designConvolutionKernel() -> void;
+
+   //!   Measures the average run time of a filter implementation
+   /**
+    * @param[in]  deviceID the ID of the device the filter is executed on
+    * @param[in]  filter   launches the filter implementation on the given sinogram in the device's stream
+    * @param[in]  data     a sinogram on the device used for the measurement
+    *
+    * @return  the run time for one sinogram in milliseconds
+    */
+	auto benchmarkFilter(const int deviceID, const std::function<void(float*)>& filter, float* data) -> float;
 };
 }
 }
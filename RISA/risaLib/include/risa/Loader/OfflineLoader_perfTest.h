@@ -34,6 +34,7 @@
 #include <tiffio.h>
 
 #include "../Basics/performance.h"
+#include "../Basics/DetectorLayout.h"
 
 #include <boost/log/trivial.hpp>
 
@@ -81,6 +82,7 @@ namespace risa
             int numberOfDetectors_; //!< the number of detectors in the fan beam sinogram
             int numberOfProjections_;   //!< the number of projections in the fan beam sinogram
             int numberOfDetectorModules_; //!< the number of detector modules
+            DetectorLayout layout_;       //!< the module structure of the raw data
             int numberOfPlanes_; //!< the number of planes
             unsigned int numberOfFrames_; //!< the number of frames in the input data for one plane
 
@@ -0,0 +1,131 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ *
+ */
+
+
+#ifndef INPUTRING_H_
+#define INPUTRING_H_
+
+#include <glados/Image.h>
+#include <glados/MemoryPool.h>
+#include <glados/cuda/HostMemoryManager.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace risa {
+
+//! The input ring buffer, which the ReceiverModules write the raw sinograms to
+/**
+ * Each slot holds one complete raw sinogram in pinned host memory from the MemoryPool. The
+ * ReceiverModules write their parts directly to their module offset, so the sinogram is ordered
+ * module by module like it is expected by the pipeline. When a sinogram is complete, the Receiver
+ * takes its memory out of the ring and passes it to the pipeline without copying. The slot gets
+ * new memory from the MemoryPool instead, the taken memory returns to the pool, when the pipeline
+ * released the image.
+ *
+ * The MemoryPool holds numberOfSlots + numberOfInFlight + 1 sinograms. Each slot records the newest
+ * sinogram, that a ReceiverModule started to write into it. A sinogram is only taken, if its slot was
+ * not reused by a newer sinogram before or while its memory was swapped.
+ */
+class InputRing {
+public:
+   using manager_type = glados::cuda::HostMemoryManager<unsigned short, glados::cuda::async_copy_policy>;
+
+public:
+   //! allocates the slots of the ring buffer
+   /**
+    * @param[in]  numberOfSlots     the number of sinograms in the ring buffer
+    * @param[in]  sinogramSize      the number of values per sinogram
+    * @param[in]  numberOfInFlight  the number of sinograms, that can be processed by the pipeline at the same time
+    */
+   InputRing(unsigned int numberOfSlots, std::size_t sinogramSize, unsigned int numberOfInFlight) :
+      numberOfSlots_{numberOfSlots}, slots_{new std::atomic<unsigned short*>[numberOfSlots]},
+      claims_{new std::atomic<std::size_t>[numberOfSlots]} {
+      memoryPoolIndex_ = glados::MemoryPool<manager_type>::instance()->registerStage(numberOfSlots + numberOfInFlight + 1, sinogramSize);
+      images_.reserve(numberOfSlots);
+      for(auto i = 0u; i < numberOfSlots; i++){
+         images_.push_back(glados::MemoryPool<manager_type>::instance()->requestMemory(memoryPoolIndex_));
+         slots_[i].store(images_[i].container().get());
+         claims_[i].store(i);
+      }
+   }
+
+   //! the memory of the slot, to which the sinogram with the given index is written
+   /**
+    * Marks the slot as used by this sinogram, an older sinogram in the slot can not be taken anymore.
+    */
+   auto slot(std::size_t index) -> unsigned short* {
+      auto& claim = claims_[index % numberOfSlots_];
+      std::size_t claimed = claim.load();
+      while(claimed < index && !claim.compare_exchange_weak(claimed, index));
+      return slots_[index % numberOfSlots_].load();
+   }
+
+   //! true, if no newer sinogram was written to the slot of the sinogram with the given index
+   auto holds(std::size_t index) const -> bool {
+      return claims_[index % numberOfSlots_].load() == index;
+   }
+
+   //! requests the memory, which replaces the next taken sinogram in its slot
+   /**
+    * Blocks until the pipeline releases an image, if all images of the MemoryPool are in use.
+    * Call it before waiting for a complete sinogram, so that #take does not block.
+    */
+   auto prepare() -> void {
+      if(!replacement_.valid())
+         replacement_ = glados::MemoryPool<manager_type>::instance()->requestMemory(memoryPoolIndex_);
+   }
+
+   //! takes the sinogram with the given index out of the ring buffer
+   /**
+    * @param[in]  index  the index of a complete sinogram
+    * @return  the image holding the sinogram, an invalid image if the slot was reused by a newer
+    *          sinogram in the meantime
+    */
+   auto take(std::size_t index) -> glados::Image<manager_type> {
+      const std::size_t slot = index % numberOfSlots_;
+      if(!holds(index))
+         return glados::Image<manager_type>();
+      prepare();
+      std::swap(images_[slot], replacement_);
+      slots_[slot].store(images_[slot].container().get());
+      auto sinogram = std::move(replacement_);
+      //a ReceiverModule started the next sinogram in the slot during the swap and may have written to the taken memory
+      if(!holds(index))
+         return glados::Image<manager_type>();
+      return sinogram;
+   }
+
+private:
+   unsigned int numberOfSlots_;
+   std::vector<glados::Image<manager_type>> images_;   //!< owns the memory of the slots
+   std::unique_ptr<std::atomic<unsigned short*>[]> slots_;  //!< the memory of the slots, read by the ReceiverModules
+   std::unique_ptr<std::atomic<std::size_t>[]> claims_;     //!< the newest sinogram, that was written to each slot
+   glados::Image<manager_type> replacement_;           //!< the memory for the slot of the next taken sinogram
+   unsigned int memoryPoolIndex_;
+};
+
+}
+
+#endif /* INPUTRING_H_ */
@@ -21,67 +21,174 @@
  *
  */
 
+
 #ifndef ONLINERECEIVERNOTIFICATION_H_
 #define ONLINERECEIVERNOTIFICATION_H_
 
 #include <boost/log/trivial.hpp>
 
-#include <vector>
-#include <mutex>
-#include <condition_variable>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 
 namespace risa{
 
 //! This class implements the synchronization between the ReceiverModule class and the superior Receiver class
+/**
+ * The completion of each sinogram in the input ring buffer is tracked without a lock. Each slot of
+ * the ring buffer owns one atomic word: the lower bits hold a bitmask of the ReceiverModules, that
+ * have received their part of the sinogram, the upper bits the generation of the slot, i.e. the
+ * sinogram index divided by the number of slots. Only the ReceiverModule, that completes a
+ * sinogram, wakes the Receiver.
+ *
+ * A sinogram, that is completed after a newer one, is queued separately. This happens, when the
+ * packets of the modules arrive in a different order, and for every sinogram, whose missing parts
+ * are filled by the incompleteSinograms policy after the reorder window. The queue holds at most
+ * one sinogram per slot, older ones are overwritten in the input ring buffer anyway.
+ */
    class OnlineReceiverNotification {
 
    public:
-      OnlineReceiverNotification(int size) : size_{size}, lastIndex_(0u)
+      //! the number of bits of a slot word, which are at least left for the generation
+      static constexpr int minGenerationBits = 16;
+
+      OnlineReceiverNotification(int size = 0, unsigned int numberOfSlots = 1) : size_{0}, lastIndex_(0u)
       {
+         resize(size, numberOfSlots);
+      }
+
+      //! sets the number of ReceiverModules, that need to notify about a new sinogram
+      /**
+       * Must not be called, while ReceiverModules are running.
+       *
+       * @param[in]  size           the number of ReceiverModules
+       * @param[in]  numberOfSlots  the number of sinograms in the input ring buffer
+       */
+      void resize(int size, unsigned int numberOfSlots){
          BOOST_LOG_TRIVIAL(debug) << "Resizing to " << size << " elements.";
-         indeces_.resize(size);
+         if(size > 64 - minGenerationBits)
+            throw std::runtime_error("OnlineReceiverNotification: Too many detector modules.");
+         size_ = size;
+         numberOfSlots_ = std::max(numberOfSlots, 1u);
+         moduleMask_ = (std::uint64_t{1} << size_) - 1;
+         generationMask_ = ~std::uint64_t{0} >> size_;
+         slots_.reset(new std::atomic<std::uint64_t>[numberOfSlots_]);
+         for(auto i = 0u; i < numberOfSlots_; i++)
+            slots_[i].store(0u);
+         sinograms_.reset(new std::atomic<std::size_t>[size_]);
+         for(auto i = 0; i < size_; i++)
+            sinograms_[i].store(0u);
+         latestComplete_.store(0u);
+         finished_.store(0);
+         late_.clear();
       }
 
-      //! checks, if complete new sinogram is available
+      //! waits until a new complete sinogram is available
       /**
-       * Therefore, this function finds the minimum element in @indices_ and returns it.
-       * For the minimum element, it can be guaranteed, that the sinogram is complete
+       * Sinograms, that were completed after a newer one, are returned first. Otherwise, if several
+       * sinograms were completed since the last call, the most recent one is returned.
        *
-       * @return the index of the last complete sinogram available in the buffers
+       * @return the index of the last complete sinogram available in the buffers, -1 if all
+       *         ReceiverModules finished
        */
       std::size_t fetch(){
-         BOOST_LOG_TRIVIAL(debug) << "Indices size: " << indeces_.size();
          auto lock = std::unique_lock<std::mutex>{mutex_};
-         auto minElement = std::min_element(std::begin(indeces_), std::end(indeces_));
-         while(minElement == std::end(indeces_) || *minElement <= lastIndex_){
-            cv_.wait(lock);
-            minElement = std::min_element(std::begin(indeces_), std::end(indeces_));
+         cv_.wait(lock, [this]{
+            return !late_.empty() || latestComplete_.load() > lastIndex_ || finished_.load() == size_;
+         });
+         if(!late_.empty()){
+            const std::size_t index = late_.front();
+            late_.pop_front();
+            BOOST_LOG_TRIVIAL(debug) << "########### SINO " << index << " completed late.";
+            return index;
+         }
+         const std::size_t index = latestComplete_.load();
+         if(index <= lastIndex_){
+            for(auto i = 0; i < size_; i++)
+               BOOST_LOG_TRIVIAL(info) << "ReceiverModule " << i << " completed " << sinograms_[i].load() << " sinograms.";
+            return -1;
          }
-         BOOST_LOG_TRIVIAL(debug) << "########### SINO " << *minElement << " complete.";
-         lastIndex_ = *minElement;
-         return *minElement;
+         BOOST_LOG_TRIVIAL(debug) << "########### SINO " << index << " complete.";
+         lastIndex_ = index;
+         return index;
       }
 
-      //! This function inserts the  new sinogram index in #indeces_ and notifies the Receiver about the arrival
+      //! This function marks the part of a ReceiverModule in the sinogram as received
       /**
+       * Duplicate notifications and notifications for a sinogram, whose slot is already used by a
+       * newer sinogram, are ignored.
+       *
        * @param[in]  receiverID  the id of the ReceiverModule, that received the sinogram
-       * @param[in]  index       the index of the sinogram, that has just arrived
+       * @param[in]  index       the index of the sinogram, that has just arrived, -1 if the
+       *                         ReceiverModule finished
        */
       void notify(int receiverID, std::size_t index){
-         //lock mutex
-         std::lock_guard<std::mutex> lock(mutex_);
-         //only insert new index if index is greater (wrong package order)
-         if(indeces_[receiverID] < index)
-            indeces_[receiverID] = index;
-         //notify collector thread to check if new sinogram can be fetched
-         cv_.notify_one();
+         if(index == (std::size_t)-1){
+            if(finished_.fetch_add(1) + 1 == size_)
+               wake();
+            return;
+         }
+         auto& slot = slots_[index % numberOfSlots_];
+         const std::uint64_t generation = (index / numberOfSlots_) & generationMask_;
+         const std::uint64_t bit = std::uint64_t{1} << receiverID;
+         std::uint64_t current = slot.load(std::memory_order_acquire);
+         std::uint64_t desired;
+         do{
+            const std::uint64_t age = (generation - (current >> size_)) & generationMask_;
+            std::uint64_t mask = current & moduleMask_;
+            //the slot already holds a newer sinogram
+            if(age > generationMask_/2)
+               return;
+            //first part of this sinogram, the slot still holds an older one
+            if(age != 0)
+               mask = 0;
+            if(mask & bit)
+               return;
+            desired = (generation << size_) | mask | bit;
+         }while(!slot.compare_exchange_weak(current, desired, std::memory_order_acq_rel, std::memory_order_acquire));
+         sinograms_[receiverID].fetch_add(1, std::memory_order_relaxed);
+         if((desired & moduleMask_) != moduleMask_)
+            return;
+         std::size_t latest = latestComplete_.load();
+         while(latest < index && !latestComplete_.compare_exchange_weak(latest, index));
+         if(latest >= index){
+            //a newer sinogram was completed before, fetch would never return this one
+            {
+               std::lock_guard<std::mutex> lock(mutex_);
+               late_.push_back(index);
+               if(late_.size() > numberOfSlots_)
+                  late_.pop_front();
+            }
+            cv_.notify_one();
+            return;
+         }
+         wake();
       }
 
    private:
 
-      std::vector<std::size_t> indeces_;
+      //! wakes the Receiver, the mutex ensures, that a Receiver about to wait does not miss it
+      void wake(){
+         {
+            std::lock_guard<std::mutex> lock(mutex_);
+         }
+         cv_.notify_one();
+      }
+
+      std::unique_ptr<std::atomic<std::uint64_t>[]> slots_;   //!< completion state of each ring buffer slot
+      std::unique_ptr<std::atomic<std::size_t>[]> sinograms_; //!< number of sinogram parts received by each module
+      std::atomic<std::size_t> latestComplete_;  //!< the index of the newest complete sinogram
+      std::deque<std::size_t> late_;             //!< sinograms completed after a newer one, guarded by mutex_
+      std::atomic<int> finished_;                //!< the number of finished ReceiverModules
       int size_;
+      unsigned int numberOfSlots_;
+      std::uint64_t moduleMask_;
+      std::uint64_t generationMask_;
       std::mutex mutex_;
       std::condition_variable cv_;
       std::size_t lastIndex_;
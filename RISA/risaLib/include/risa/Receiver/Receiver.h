@@ -26,6 +26,9 @@
 
 #include "../ReceiverModule/ReceiverModule.h"
 #include "OnlineReceiverNotification.h"
+#include "InputRing.h"
+
+#include <risa/Basics/DetectorLayout.h>
 
 #include <glados/Queue.h>
 #include <glados/Image.h>
@@ -33,9 +36,9 @@
 
 #include <vector>
 #include <thread>
-#include <map>
 #include <atomic>
 #include <queue>
+#include <memory>
 
 namespace risa {
 
@@ -60,23 +63,39 @@ public:
    auto loadImage() -> glados::Image<manager_type>;
 
    auto run() -> void;
+
+   //! the packet statistics of a detector module
+   auto statistics(int moduleID) const -> const ReceiverStatistics& { return modules_[moduleID].statistics(); }
+
 private:
+   //! receives the UDP packets of several detector modules in one thread
+   /**
+    * Waits with epoll for packets on the sockets of all given modules and lets the modules,
+    * whose sockets are ready, receive a batch of packets. A module is finished, if it did
+    * not receive a packet for #timeout_ seconds.
+    *
+    * @param[in]  moduleIDs  the detector modules handled by this thread
+    */
+   auto receive(std::vector<int> moduleIDs) -> void;
+
    std::vector<ReceiverModule> modules_;
 
-   std::map<unsigned int, std::vector<unsigned short>> buffers_;  //!< one input buffer for each detector module
+   std::unique_ptr<InputRing> ring_;  //!< the input buffer, the detector modules write their parts of the sinograms to
 
-   std::vector<std::thread> moduleThreads_;  //!< stores the ReceiverModule threads
+   std::vector<std::thread> moduleThreads_;  //!< stores the threads receiving the packets
+
+   transportProtocol transportProtocol_;  //!< TCP uses one thread per module, UDP a few multiplexing threads
+   int numberOfReceiverThreads_{1};       //!< the number of threads receiving the UDP packets
+   int timeout_;                          //!< after this duration in s without packets, a module is finished
 
    OnlineReceiverNotification notification_; //!< performs the synchronization between the Receiver and the ReceiverModules, to know when a complete sinogramm is ready
 
-   std::array<std::atomic<int>, 27> lastEntry_; //!< stores the last indices of the received sinogramms
+   DetectorLayout layout_;       //!< the module structure of the raw data
 
    int numberOfDetectorModules_; //!< the number of detector modules
    int numberOfDetectors_;       //!< the number of detectors in the fan beam sinogram
    int numberOfProjections_;     //!< the number of projections in the fan beam sinogram
 
-   unsigned int memoryPoolIndex_;
-
    unsigned int bufferSize_;
 
    auto readConfig(const std::string& configFile) -> bool;
@@ -25,12 +25,18 @@
 
 #include "../UDPServer/UDPServer.h"
 #include "../Receiver/OnlineReceiverNotification.h"
+#include "../Receiver/InputRing.h"
+
+#include <risa/Basics/DetectorLayout.h>
 
 #include <glados/Queue.h>
 
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <cstdint>
+#include <memory>
+#include <limits>
 
 namespace risa {
 
@@ -39,6 +45,23 @@ namespace risa {
       TCP
    };
 
+   //! the handling of sinograms, whose packets did not arrive completely
+   enum incompleteSinogramPolicy: short {
+      DROP,          //!< the sinogram is not passed to the pipeline
+      ZERO,          //!< the missing projections are set to zero
+      INTERPOLATE    //!< the missing projections are interpolated from the neighbouring projections
+   };
+
+   //! the packet statistics of a ReceiverModule, which can be read while it is running
+   struct ReceiverStatistics {
+      std::atomic<std::size_t> receivedPackets{0u};      //!< the number of received packets
+      std::atomic<std::size_t> lostPackets{0u};          //!< the number of packets, which did not arrive in the reorder window
+      std::atomic<std::size_t> latePackets{0u};          //!< the number of packets, which arrived after their sinogram was given up
+      std::atomic<std::size_t> invalidPackets{0u};       //!< the number of packets with a wrong size or part ID
+      std::atomic<std::size_t> incompleteSinograms{0u};  //!< the number of sinograms with missing packets
+      std::atomic<std::size_t> droppedSinograms{0u};     //!< the number of sinograms, which were not passed to the pipeline
+   };
+
    //! Each ReceiverModule is bound to one DetectorModule.
    /**
     * It receives the packets via an interconnection network. So far, UDP and TCP transport protocols
@@ -47,18 +70,35 @@ namespace risa {
 class ReceiverModule {
 public:
    ReceiverModule(const std::string& address, const std::string& configPath, const int moduleID,
-         std::vector<unsigned short>& buffer, OnlineReceiverNotification& notification);
+         const DetectorLayout& layout, InputRing& ring, OnlineReceiverNotification& notification);
 
    auto run() -> void;
    auto stop() -> void {run_ = false;}
 
+   //! receives the packets, that are available at the socket, with one system call
+   /**
+    * Blocks at most #timeout_ seconds, if no packet is available.
+    *
+    * @return  the number of received packets, or -1 if no packet arrived
+    */
+   auto receiveBatch() -> int;
+
+   //! notifies the Receiver, that no more sinograms will arrive from this module
+   auto finish() -> void;
+
+   //! the file descriptor to wait for incoming packets on several modules at once
+   /**
+    * Call it from the thread, which calls #receiveBatch.
+    */
+   auto eventFd() -> int { return udpServer_.get_event_fd(); }
+
+   auto statistics() const -> const ReceiverStatistics& { return *statistics_; }
+
 private:
 
    UDPServer udpServer_;   //!< the class, which performs the UDP transaction
 
-   std::vector<unsigned short>& buffer_;  //!< the input buffer, which stores a configurable amount of sinograms
-
-   std::size_t lastIndex_{0u};   //!< identifier to check, whether a packet was lost
+   InputRing& ring_;  //!< the input buffer, which stores a configurable amount of sinograms
 
    int numberOfDetectorModules_; //!< the number of detector modules
    int numberOfDetectors_;        //!< the number of detectors in the fan beam sinogram
@@ -70,6 +110,31 @@ private:
    std::string address_; //!< the ip address of the sender
    transportProtocol transportProtocol_;  //!< specifies the prefered transport protocol
    int timeout_;  //!< after this duration in s, the connection is closed
+   int packetsPerBatch_{64};  //!< the maximum number of UDP packets received with one system call
+   bool useIoUring_{false};   //!< receive the UDP packets via io_uring instead of recvmmsg
+
+   std::unique_ptr<PacketBatch> batch_;      //!< the message headers for the batched receive
+   std::vector<unsigned short> misplaced_;   //!< payloads received at a wrong position in the ring buffer
+   std::vector<std::size_t> packetNumbers_;  //!< the consecutive packet numbers of the last batch
+   static constexpr std::size_t invalidPacket = std::numeric_limits<std::size_t>::max(); //!< marks malformed packets in #packetNumbers_
+   std::size_t expectedPacket_{0u};          //!< the packet number, which is expected to arrive next
+   std::size_t sinoSize_;                    //!< the number of values of this module per sinogram
+   std::size_t moduleOffset_;                //!< the position of this module's values in the sinogram
+   std::size_t packetSize_;                  //!< the number of values per packet
+   std::size_t partsPerSinogram_;            //!< the number of packets per sinogram
+
+   //! received packets are tracked per slot of the input buffer
+   std::vector<std::uint64_t> receivedParts_;   //!< bitmap of the received packets of each slot
+   std::vector<std::size_t> slotIndex_;         //!< the index of the sinogram stored in each slot
+   std::vector<std::size_t> slotParts_;         //!< the number of received packets of each slot
+   std::size_t wordsPerSlot_;                   //!< the number of bitmap words per slot
+   std::size_t nextIndex_{0u};                  //!< all older sinograms are passed on or given up
+   std::size_t newestIndex_{0u};                //!< the newest sinogram, a packet was received for
+   bool started_{false};                        //!< true, once the first packet was received
+   int reorderWindow_{2};                       //!< an incomplete sinogram is given up, when a packet this many sinograms newer arrives
+   incompleteSinogramPolicy incompletePolicy_{incompleteSinogramPolicy::DROP};  //!< the handling of incomplete sinograms
+
+   std::unique_ptr<ReceiverStatistics> statistics_;   //!< the packet statistics of this module
 
    OnlineReceiverNotification& notification_;
 
@@ -81,6 +146,23 @@ private:
 
    auto readConfig(const std::string& configFile) -> bool;
 
+   //! marks a packet as received in the bitmap of its slot
+   /**
+    * @param[in]  index   the index of the sinogram
+    * @param[in]  partID  the number of the packet in the sinogram
+    * @return  false, if the packet is a duplicate or arrived too late and must be discarded
+    */
+   auto registerPart(std::size_t index, unsigned short partID) -> bool;
+
+   //! notifies the Receiver, if all packets of the sinogram arrived
+   auto notifyIfComplete(std::size_t index) -> void;
+
+   //! gives up all sinograms older than end, incomplete ones are handled according to #incompletePolicy_
+   auto finalizeSinograms(std::size_t end) -> void;
+
+   //! replaces the missing packets of an incomplete sinogram by zeros or interpolated projections
+   auto fillMissingParts(std::size_t index) -> void;
+
 };
 
 }
@@ -31,14 +31,17 @@
 
 #include <thread>
 #include <map>
+#include <string>
+#include <vector>
 
 namespace risa {
 namespace cuda {
 
 //! This stage restructures the unordered input data received from the detector modules.
 /**
- * It precomputes a hash table on device and the CUDA kernel restructures the values
- * to a raw data sinogram ordered by detectors and projections.
+ * The receiver delivers the values module by module, i.e. all projections of one detector module
+ * are stored contiguously. The CUDA kernel transposes this layout tile by tile in shared memory
+ * to a raw data sinogram ordered by projections and detectors.
  */
 class Reordering {
 public:
@@ -97,13 +100,6 @@ private:
     */
    auto processor(int deviceID) -> void;
 
-   //! This function creates the hash tabel that stores the relationship between the ordered and unordered values
-   /**
-    *
-    * @param[out] the hash table on the host memory space
-    */
-   auto createHashTable(std::vector<int>& hashTable) -> void;
-
    int numberOfDevices_;               //!< the number of available CUDA devices
 
    int numberOfDetectorsPerModule_;    //!< the number of detectors per module
@@ -26,9 +26,13 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <stdexcept>
 #include <cstring>
+#include <vector>
+
+struct io_uring;
 
 namespace risa {
 
@@ -38,6 +42,37 @@ public:
     udp_client_server_runtime_error(const char *w) : std::runtime_error(w) {}
 };
 
+//! Stores the message headers for receiving several packets with one system call
+/**
+ * Each packet is split into a fixed size header, that is stored in the batch, and
+ * the payload, that is received directly at the position set with set_payload().
+ */
+class PacketBatch
+{
+public:
+  PacketBatch(size_t number_of_packets, size_t header_size, size_t payload_size);
+  PacketBatch(const PacketBatch&) = delete;
+  PacketBatch& operator=(const PacketBatch&) = delete;
+
+  size_t              capacity() const { return f_headers.size(); }
+  const char *        header(size_t i) const { return f_header_data.data() + i * f_header_size; }
+  char *              header(size_t i) { return f_header_data.data() + i * f_header_size; }
+  size_t              header_size() const { return f_header_size; }
+  size_t              payload_size(size_t i) const { return f_iovecs[2 * i + 1].iov_len; }
+  char *              payload(size_t i) const { return (char *)f_iovecs[2 * i + 1].iov_base; }
+  void                set_payload(size_t i, char *target) { f_iovecs[2 * i + 1].iov_base = target; }
+  //! the number of bytes received in packet i including the header by the last UDPServer::recv_batch()
+  int                 packet_bytes(size_t i) const { return f_headers[i].msg_len; }
+  void                set_packet_bytes(size_t i, int bytes) { f_headers[i].msg_len = bytes; }
+  mmsghdr *           headers() { return f_headers.data(); }
+
+private:
+  size_t              f_header_size;
+  std::vector<char>   f_header_data;
+  std::vector<iovec>  f_iovecs;
+  std::vector<mmsghdr> f_headers;
+};
+
 class UDPServer
 {
 public:
@@ -45,17 +80,31 @@ public:
   ~UDPServer();
 
   int                 get_socket() const;
+  int                 get_event_fd();
   int                 get_port() const;
   std::string         get_addr() const;
 
   int                 recv(char *msg, size_t max_size);
   int                 timed_recv(char *msg, size_t max_size, int max_wait_ms);
+  void                set_timeout(int max_wait_s);
+  int                 recv_batch(PacketBatch& batch);
+  bool                enable_io_uring(size_t number_of_buffers, size_t buffer_size);
 
 private:
+  bool                arm_io_uring();
+  int                 recv_batch_io_uring(PacketBatch& batch);
+
   int                 f_socket;
   int                 f_port;
   std::string         f_addr;
   struct addrinfo *   f_addrinfo;
+  int                 f_timeout = 0;
+
+  //! io_uring backend, only used after a successful enable_io_uring()
+  struct io_uring *   f_ring = NULL;
+  std::vector<char>   f_buffers;
+  size_t              f_buffer_size = 0;
+  bool                f_armed = false;
 };
 
 }
@@ -26,6 +26,7 @@
 #include <risa/Attenuation/Attenuation.h>
 #include <risa/ConfigReader/ConfigReader.h>
 #include <risa/Basics/performance.h>
+#include <risa/Basics/geometry.h>
 
 #include <glados/cuda/Launch.h>
 #include <glados/cuda/Check.h>
@@ -38,6 +39,7 @@
 #include <iostream>
 #include <cmath>
 #include <fstream>
+#include <algorithm>
 #include <iterator>
 #include <exception>
 #include <pthread.h>
@@ -45,6 +47,9 @@
 namespace risa {
 namespace cuda {
 
+//! the number of different raw values delivered by the 16 bit detectors
+constexpr int numberOfRawValues = 65536;
+
 Attenuation::Attenuation(const std::string& configFile) {
 
    if (readConfig(configFile)) {
@@ -137,12 +142,41 @@ auto Attenuation::processor(const int deviceID) -> void {
    CHECK(
          cudaMemcpyAsync(mask_d.get(), mask.data(), sizeof(float) * mask.size(),
                cudaMemcpyHostToDevice, streams_[deviceID]));
+   //lookup tables are empty, if the direct computation is used
+   auto logReference_d = glados::cuda::make_device_ptr<float>(logReference_.size());
+   auto logRawTables_d = glados::cuda::make_device_ptr<float>(logRawTables_.size());
+   auto logRawTableIdx_d = glados::cuda::make_device_ptr<int>(logRawTableIdx_.size());
+   if (attenuationMethod_ == detail::AttenuationMethod::lookupTable) {
+      CHECK(
+            cudaMemcpyAsync(logReference_d.get(), logReference_.data(),
+                  sizeof(float) * logReference_.size(), cudaMemcpyHostToDevice,
+                  streams_[deviceID]));
+      CHECK(
+            cudaMemcpyAsync(logRawTables_d.get(), logRawTables_.data(),
+                  sizeof(float) * logRawTables_.size(), cudaMemcpyHostToDevice,
+                  streams_[deviceID]));
+      CHECK(
+            cudaMemcpyAsync(logRawTableIdx_d.get(), logRawTableIdx_.data(),
+                  sizeof(int) * logRawTableIdx_.size(), cudaMemcpyHostToDevice,
+                  streams_[deviceID]));
+   }
 
    dim3 blocks(blockSize2D_, blockSize2D_);
    dim3 grids(std::ceil(numberOfDetectors_ / (float)blockSize2D_),
          std::ceil(numberOfProjections_ / (float)blockSize2D_));
    float temp = pow(10, -5);
    CHECK(cudaStreamSynchronize(streams_[deviceID]));
+   const bool useSpecializedKernel = numberOfDetectors_ == geometry::numberOfFanDetectors
+         && numberOfProjections_ == geometry::numberOfFanProjections;
+   const auto attenuationKernel = geometry::selectKernel(useSpecializedKernel,
+         computeAttenuation<geometry::numberOfFanDetectors, geometry::numberOfFanProjections>, computeAttenuation<0, 0>);
+   const auto attenuationLUTKernel = geometry::selectKernel(useSpecializedKernel,
+         computeAttenuationLUT<geometry::numberOfFanDetectors, geometry::numberOfFanProjections>, computeAttenuationLUT<0, 0>);
+   BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::Attenuation: Using " << (useSpecializedKernel ? "specialized" : "generic") << " attenuation kernel.";
+   //a zero tells the kernel, that the input is already in detector order
+   const int numberOfDetectorsPerModule = fuseReordering_ ? numberOfDetectorsPerModule_ : 0;
+   if(fuseReordering_)
+      BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::Attenuation: Reordering is fused into the attenuation kernel.";
    BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::Attenuation: Running Thread for Device " << deviceID;
 
    while (true) {
@@ -155,10 +189,16 @@ auto Attenuation::processor(const int deviceID) -> void {
             glados::MemoryPool<deviceManagerType>::instance()->requestMemory(
                   memoryPoolIdxs_[deviceID]);
 
-      computeAttenuation<<<grids, blocks, 0, streams_[deviceID]>>>(
-            sinogram.container().get(), mask_d.get(), sino.container().get(),
-            avgReference_d.get(), avgDark_d.get(), temp, numberOfDetectors_,
-            numberOfProjections_, sinogram.plane());
+      if(attenuationMethod_ == detail::AttenuationMethod::lookupTable)
+         attenuationLUTKernel<<<grids, blocks, 0, streams_[deviceID]>>>(
+               sinogram.container().get(), mask_d.get(), sino.container().get(),
+               logReference_d.get(), logRawTables_d.get(), logRawTableIdx_d.get(),
+               numberOfDetectors_, numberOfProjections_, sinogram.plane(), numberOfDetectorsPerModule);
+      else
+         attenuationKernel<<<grids, blocks, 0, streams_[deviceID]>>>(
+               sinogram.container().get(), mask_d.get(), sino.container().get(),
+               avgReference_d.get(), avgDark_d.get(), temp, numberOfDetectors_,
+               numberOfProjections_, sinogram.plane(), numberOfDetectorsPerModule);
       CHECK(cudaPeekAtLastError());
 
       sino.setIdx(sinogram.index());
@@ -187,7 +227,8 @@ auto Attenuation::init() -> void {
       pathReference_.append("/");
    std::string refPath = pathReference_ + "ref_empty_tomograph_repaired_DetModNr_";
    readInput(refPath, referenceValues, numberOfRefFrames_);
-   //interpolate reference measurement
+   //interpolate reference measurement, the frames are independent of each other
+#pragma omp parallel for
    for(auto i = 0; i < numberOfRefFrames_*numberOfPlanes_; i++){
       std::vector<int> defectDetectors(numberOfProjections_*numberOfDetectors_);
       findDefectDetectors(referenceValues.data()+i*numberOfDetectors_*numberOfProjections_, filterFunction, defectDetectors, numberOfDetectors_, numberOfProjections_,
@@ -214,6 +255,53 @@ auto Attenuation::init() -> void {
          }
       }
    }
+
+   if(attenuationMethod_ == detail::AttenuationMethod::lookupTable)
+      computeLookupTables();
+}
+
+auto Attenuation::computeLookupTables() -> void {
+   //same clamping as in the direct computation
+   const float temp = pow(10, -5);
+   const auto sinogramSize = numberOfDetectors_ * numberOfProjections_;
+
+   //the dark values are quantized, so that detectors with similar dark values share one table
+   std::vector<float> darkQuantized(numberOfPlanes_ * numberOfDetectors_);
+   for(auto i = 0; i < numberOfPlanes_ * numberOfDetectors_; i++)
+      darkQuantized[i] = std::round(avgDark_[i] / darkQuantization_) * darkQuantization_;
+
+   //first term: log(reference - dark), fixed for each pixel
+   logReference_.resize(numberOfPlanes_ * sinogramSize);
+#pragma omp parallel for
+   for(auto planeInd = 0; planeInd < numberOfPlanes_; planeInd++){
+      for(auto i = 0; i < sinogramSize; i++){
+         const float dark = darkQuantized[planeInd * numberOfDetectors_ + i % numberOfDetectors_];
+         const float denominator = avgReference_[planeInd * sinogramSize + i] - dark;
+         logReference_[planeInd * sinogramSize + i] = std::log(std::max(denominator, temp));
+      }
+   }
+
+   //second term: log(raw - dark), detectors with the same quantized dark value share one table
+   std::map<float, int> tableOfDarkValue;
+   std::vector<float> darkValues;
+   logRawTableIdx_.resize(numberOfPlanes_ * numberOfDetectors_);
+   for(auto i = 0; i < numberOfPlanes_ * numberOfDetectors_; i++){
+      auto inserted = tableOfDarkValue.emplace(darkQuantized[i], (int)darkValues.size());
+      if(inserted.second)
+         darkValues.push_back(darkQuantized[i]);
+      logRawTableIdx_[i] = inserted.first->second;
+   }
+   logRawTables_.resize(darkValues.size() * numberOfRawValues);
+#pragma omp parallel for
+   for(auto tableInd = 0; tableInd < (int)darkValues.size(); tableInd++){
+      for(auto raw = 0; raw < numberOfRawValues; raw++){
+         const float numerator = (float)raw - darkValues[tableInd];
+         logRawTables_[tableInd * numberOfRawValues + raw] = std::log(std::max(numerator, temp));
+      }
+   }
+   BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::Attenuation: Computed " << darkValues.size() << " lookup tables for "
+         << numberOfPlanes_ * numberOfDetectors_ << " detectors, requiring "
+         << (logRawTables_.size() + logReference_.size()) * sizeof(float) / (1024 * 1024) << " MiB per device.";
 }
 
 template <typename T>
@@ -281,12 +369,14 @@ auto Attenuation::readInput(std::string& path,
    tmr1.start();
    tmr2.start();
 #pragma omp parallel for default(shared) //num_threads(9)
-   for (auto i = 1; i <= numberOfDetectorModules_; i++) {
+   for (auto i = 0; i < numberOfDetectorModules_; i++) {
       std::vector<T> content;
       //TODO: make filename and ending configurable
-      std::ifstream input(path + std::to_string(i) + ".fx", std::ios::in | std::ios::binary);
+      //the files are numbered by the physical module id, starting at 1
+      const auto fileName = path + std::to_string(layout_.module(i) + 1) + ".fx";
+      std::ifstream input(fileName, std::ios::in | std::ios::binary);
       if (!input) {
-         BOOST_LOG_TRIVIAL(error)<< "recoLib::cuda::Attenuation: Source file " << path + std::to_string(i) + ".fx" << " could not be loaded.";
+         BOOST_LOG_TRIVIAL(error)<< "recoLib::cuda::Attenuation: Source file " << fileName << " could not be loaded.";
          throw std::runtime_error("File could not be opened. Please check!");
       }
       //allocate memory in vector
@@ -296,10 +386,10 @@ auto Attenuation::readInput(std::string& path,
       input.seekg(0, std::ios::beg);
       content.resize(fileSize / sizeof(T));
       input.read((char*) &content[0], fileSize);
-      fileContents[i - 1] = content;
+      fileContents[i] = content;
    }
    tmr2.stop();
-   int numberOfDetPerModule = numberOfDetectors_ / numberOfDetectorModules_;
+   int numberOfDetPerModule = numberOfDetectorsPerModule_;
    values.resize(fileContents[0].size() * numberOfDetectorModules_);
    for (auto i = 0; i < numberOfFrames; i++) {
       for (auto planeInd = 0; planeInd < numberOfPlanes_; planeInd++) {
@@ -385,7 +475,7 @@ auto Attenuation::readConfig(const std::string& configFile) -> bool {
          configFile.data());
    int samplingRate, scanRate;
    if (configReader.lookupValue("numberOfFanDetectors", numberOfDetectors_)
-         && configReader.lookupValue("numberOfDetectorModules", numberOfDetectorModules_)
+         && !layout_.readConfig(configFile)
          && configReader.lookupValue("numberOfReferenceFrames", numberOfRefFrames_)
          && configReader.lookupValue("darkInputPath", pathDark_)
          && configReader.lookupValue("referenceInputPath", pathReference_)
@@ -407,18 +497,39 @@ auto Attenuation::readConfig(const std::string& configFile) -> bool {
          && configReader.lookupValue("thresh_max", threshMax_)
          && configReader.lookupValue("chunkSize", chunkSize_)) {
       numberOfProjections_ = samplingRate * 1000000 / scanRate;
+      //optional parameter, the direct computation is used if not specified
+      std::string attenuationMethod = "direct";
+      configReader.lookupValue("attenuationMethod", attenuationMethod);
+      if (attenuationMethod == "lookupTable")
+         attenuationMethod_ = detail::AttenuationMethod::lookupTable;
+      else if (attenuationMethod != "direct")
+         BOOST_LOG_TRIVIAL(warning) << "recoLib::cuda::Attenuation: Requested attenuation method not supported. Using direct computation.";
+      //optional: step size in counts, to which the dark values of the lookup tables are rounded
+      configReader.lookupValue("darkQuantization", darkQuantization_);
+      if (darkQuantization_ <= 0.0) {
+         BOOST_LOG_TRIVIAL(warning) << "recoLib::cuda::Attenuation: darkQuantization needs to be positive. Using 1.0.";
+         darkQuantization_ = 1.0;
+      }
+      numberOfDetectorModules_ = layout_.numberOfModules();
+      numberOfDetectorsPerModule_ = layout_.numberOfDetectorsPerModule();
+      fuseReordering_ = layout_.fuseReordering();
       return EXIT_SUCCESS;
    }
 
    return EXIT_FAILURE;
 }
 
+template <int NumberOfDetectors, int NumberOfProjections>
 __global__ void computeAttenuation(
       const unsigned short* __restrict__ sinogram_in,
-      const float* __restrict__ mask, float* __restrict__ sinogram_out,
+      const float* __restrict__ mask, fanSinogram_type* __restrict__ sinogram_out,
       const float* __restrict__ avgReference, const float* __restrict__ avgDark,
-      const float temp, const int numberOfDetectors,
-      const int numberOfProjections, const int planeId) {
+      const float temp, const int numberOfDetectorsRuntime,
+      const int numberOfProjectionsRuntime, const int planeId,
+      const int numberOfDetectorsPerModule) {
+
+   const int numberOfDetectors = geometry::select<NumberOfDetectors>(numberOfDetectorsRuntime);
+   const int numberOfProjections = geometry::select<NumberOfProjections>(numberOfProjectionsRuntime);
 
    auto x = glados::cuda::getX();
    auto y = glados::cuda::getY();
@@ -427,7 +538,17 @@ __global__ void computeAttenuation(
 
    auto sinoIndex = numberOfDetectors * y + x;
 
-   float numerator = (float) (sinogram_in[sinoIndex])
+   //the receiver delivers the data module by module, i.e. all projections of one
+   //module are stored contiguously, gather the value directly from there
+   auto inputIndex = sinoIndex;
+   if (numberOfDetectorsPerModule > 0) {
+      const int module = x / numberOfDetectorsPerModule;
+      const int detector = x - module * numberOfDetectorsPerModule;
+      inputIndex = detector + y * numberOfDetectorsPerModule
+            + module * numberOfDetectorsPerModule * numberOfProjections;
+   }
+
+   float numerator = (float) (sinogram_in[inputIndex])
          - avgDark[planeId * numberOfDetectors + x];
 
    float denominator = avgReference[planeId * numberOfDetectors * numberOfProjections + sinoIndex]
@@ -439,8 +560,43 @@ __global__ void computeAttenuation(
       denominator = temp;
 
    //comutes the attenuation and multiplies with mask for hiding the unrelevant region
-   sinogram_out[sinoIndex] = -log(numerator / denominator) * mask[sinoIndex];
+   sinogram_out[sinoIndex] = fromFloat<fanSinogram_type>(-log(numerator / denominator) * mask[sinoIndex]);
+
+}
+
+template <int NumberOfDetectors, int NumberOfProjections>
+__global__ void computeAttenuationLUT(
+      const unsigned short* __restrict__ sinogram_in,
+      const float* __restrict__ mask, fanSinogram_type* __restrict__ sinogram_out,
+      const float* __restrict__ logReference, const float* __restrict__ logRawTables,
+      const int* __restrict__ logRawTableIdx, const int numberOfDetectorsRuntime,
+      const int numberOfProjectionsRuntime, const int planeId,
+      const int numberOfDetectorsPerModule) {
+
+   const int numberOfDetectors = geometry::select<NumberOfDetectors>(numberOfDetectorsRuntime);
+   const int numberOfProjections = geometry::select<NumberOfProjections>(numberOfProjectionsRuntime);
+
+   auto x = glados::cuda::getX();
+   auto y = glados::cuda::getY();
+   if (x >= numberOfDetectors || y >= numberOfProjections)
+      return;
+
+   auto sinoIndex = numberOfDetectors * y + x;
+
+   auto inputIndex = sinoIndex;
+   if (numberOfDetectorsPerModule > 0) {
+      const int module = x / numberOfDetectorsPerModule;
+      const int detector = x - module * numberOfDetectorsPerModule;
+      inputIndex = detector + y * numberOfDetectorsPerModule
+            + module * numberOfDetectorsPerModule * numberOfProjections;
+   }
+
+   const float* logRaw = logRawTables + logRawTableIdx[planeId * numberOfDetectors + x] * numberOfRawValues;
 
+   //-log(numerator/denominator) = log(denominator) - log(numerator)
+   sinogram_out[sinoIndex] = fromFloat<fanSinogram_type>(
+         (logReference[planeId * numberOfDetectors * numberOfProjections + sinoIndex]
+         - logRaw[sinogram_in[inputIndex]]) * mask[sinoIndex]);
 }
 
 }
@@ -23,6 +23,7 @@
 
 #include <risa/Backprojection/Backprojection.h>
 #include <risa/ConfigReader/ConfigReader.h>
+#include <risa/Basics/geometry.h>
 
 #include <glados/MemoryPool.h>
 #include <glados/cuda/Coordinates.h>
@@ -31,7 +32,9 @@
 
 #include <nvToolsExt.h>
 
+#include <algorithm>
 #include <exception>
+#include <limits>
 #include <pthread.h>
 
 namespace risa {
@@ -142,8 +145,27 @@ auto Backprojection::processor(const int deviceID) -> void {
    dim3 blocks(blockSize2D_, blockSize2D_);
    dim3 grids(std::ceil(numberOfPixels_ / (float) blockSize2D_),
          std::ceil(numberOfPixels_ / (float) blockSize2D_));
-   if(interpolationType_ == detail::InterpolationType::linear)
-      CHECK(cudaFuncSetCacheConfig(backProjectLinear, cudaFuncCachePreferL1));
+   //buffers for the fixed point back projection: quantized sinogram and per-frame maximum
+   const int sinogramSize = numberOfProjections_ * numberOfDetectors_;
+   const int blockSize1D = 256;
+   const int gridSize1D = std::min(64, (sinogramSize + blockSize1D - 1) / blockSize1D);
+   auto quantized = glados::cuda::make_device_ptr<short, glados::cuda::async_copy_policy>(
+         precision_ == detail::Precision::fixedPoint ? sinogramSize : 1);
+   auto maxAbs = glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(1);
+   const bool useSpecializedKernel = numberOfPixels_ == geometry::numberOfPixels
+         && numberOfProjections_ == geometry::numberOfParallelProjections
+         && numberOfDetectors_ == geometry::numberOfParallelDetectors;
+   const auto fixedPointKernel = geometry::selectKernel(useSpecializedKernel,
+         backProjectFixedPoint<geometry::numberOfPixels, geometry::numberOfParallelProjections, geometry::numberOfParallelDetectors>,
+         backProjectFixedPoint<0, 0, 0>);
+   const auto linearKernel = geometry::selectKernel(useSpecializedKernel,
+         backProjectLinear<geometry::numberOfPixels, geometry::numberOfParallelProjections, geometry::numberOfParallelDetectors>,
+         backProjectLinear<0, 0, 0>);
+   BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::BP: Using " << (useSpecializedKernel ? "specialized" : "generic") << " back projection kernel.";
+   if(precision_ == detail::Precision::fixedPoint)
+      CHECK(cudaFuncSetCacheConfig(fixedPointKernel, cudaFuncCachePreferL1));
+   else if(interpolationType_ == detail::InterpolationType::linear)
+      CHECK(cudaFuncSetCacheConfig(linearKernel, cudaFuncCachePreferL1));
    else if(interpolationType_ == detail::InterpolationType::neareastNeighbor)
       CHECK(cudaFuncSetCacheConfig(backProjectNearest, cudaFuncCachePreferL1));
    BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::BP: Running Thread for Device " << deviceID;
@@ -182,9 +204,18 @@ auto Backprojection::processor(const int deviceID) -> void {
          backProjectTex<<<grids, blocks, 0, streams_[deviceID]>>>(tex, recoImage.container().get(),
                              numberOfPixels_, numberOfProjections_, numberOfDetectors_);
          CHECK(cudaDestroyTextureObject(tex));
+      }else if(precision_ == detail::Precision::fixedPoint){
+         CHECK(cudaMemsetAsync(maxAbs.get(), 0, sizeof(int), streams_[deviceID]));
+         computeMaxAbs<<<gridSize1D, blockSize1D, 0, streams_[deviceID]>>>(
+               sinogram.container().get(), maxAbs.get(), sinogramSize);
+         quantizeSinogram<<<gridSize1D, blockSize1D, 0, streams_[deviceID]>>>(
+               sinogram.container().get(), quantized.get(), maxAbs.get(), quantizationMax_, sinogramSize);
+         fixedPointKernel<<<grids, blocks, 0, streams_[deviceID]>>>(
+               quantized.get(), recoImage.container().get(), maxAbs.get(), quantizationMax_,
+               numberOfPixels_, numberOfProjections_, numberOfDetectors_);
       }else{
          if(interpolationType_ == detail::InterpolationType::linear)
-            backProjectLinear<<<grids, blocks, 0, streams_[deviceID]>>>(
+            linearKernel<<<grids, blocks, 0, streams_[deviceID]>>>(
                   sinogram.container().get(), recoImage.container().get(),
                   numberOfPixels_, numberOfProjections_, numberOfDetectors_);
          else if(interpolationType_ == detail::InterpolationType::neareastNeighbor)
@@ -211,6 +242,9 @@ auto Backprojection::readConfig(const std::string& configFile) -> bool {
    ConfigReader configReader = ConfigReader(
          configFile.data());
    std::string interpolationStr;
+   std::string precisionStr = "float";
+   //optional parameter, float precision is used if not specified
+   configReader.lookupValue("backProjectionPrecision", precisionStr);
    if (configReader.lookupValue("numberOfParallelProjections", numberOfProjections_)
          && configReader.lookupValue("numberOfParallelDetectors", numberOfDetectors_)
          && configReader.lookupValue("numberOfPixels", numberOfPixels_)
@@ -229,17 +263,34 @@ auto Backprojection::readConfig(const std::string& configFile) -> bool {
          interpolationType_ = detail::InterpolationType::linear;
       }
 
+      if(precisionStr == "int16"){
+         if(interpolationType_ != detail::InterpolationType::linear || useTextureMemory_)
+            BOOST_LOG_TRIVIAL(warning) << "recoLib::cuda::Backprojection: Fixed point back projection only supports linear interpolation without texture memory. Using float precision.";
+         else
+            precision_ = detail::Precision::fixedPoint;
+      }else if(precisionStr != "float")
+         BOOST_LOG_TRIVIAL(warning) << "recoLib::cuda::Backprojection: Requested precision not supported. Using float precision.";
+
+      //the int32 accumulator must not overflow: numberOfProjections * weightScale * quantizationMax < 2^31
+      quantizationMax_ = std::min(32767,
+            std::numeric_limits<int>::max() / (detail::fixedPointWeightScale * numberOfProjections_));
+
       return EXIT_SUCCESS;
    }
 
    return EXIT_FAILURE;
 }
 
+template <int NumberOfPixels, int NumberOfProjections, int NumberOfDetectors>
 __global__ void backProjectLinear(const float* const __restrict__ sinogram,
          float* __restrict__ image,
-         const int numberOfPixels,
-         const int numberOfProjections,
-         const int numberOfDetectors){
+         const int numberOfPixelsRuntime,
+         const int numberOfProjectionsRuntime,
+         const int numberOfDetectorsRuntime){
+
+   const int numberOfPixels = geometry::select<NumberOfPixels>(numberOfPixelsRuntime);
+   const int numberOfProjections = geometry::select<NumberOfProjections>(numberOfProjectionsRuntime);
+   const int numberOfDetectors = geometry::select<NumberOfDetectors>(numberOfDetectorsRuntime);
 
    const auto x = glados::cuda::getX();
    const auto y = glados::cuda::getY();
@@ -334,6 +385,82 @@ __global__ void backProjectNearest(const float* const __restrict__ sinogram,
    }
    image[x + y * numberOfPixels] = sum * M_PI / numberOfProjections * scale;
 }
+__global__ void computeMaxAbs(const float* const __restrict__ sinogram,
+      int* __restrict__ maxAbs, const int size){
+
+   __shared__ float blockMax[256];
+
+   float localMax = 0.0f;
+   for(auto i = blockIdx.x * blockDim.x + threadIdx.x; i < size; i += blockDim.x * gridDim.x)
+      localMax = fmaxf(localMax, fabsf(sinogram[i]));
+   blockMax[threadIdx.x] = localMax;
+   __syncthreads();
+
+   for(auto s = blockDim.x / 2; s > 0; s >>= 1){
+      if(threadIdx.x < s)
+         blockMax[threadIdx.x] = fmaxf(blockMax[threadIdx.x], blockMax[threadIdx.x + s]);
+      __syncthreads();
+   }
+
+   //non-negative floats keep their ordering when reinterpreted as int
+   if(threadIdx.x == 0)
+      atomicMax(maxAbs, __float_as_int(blockMax[0]));
+}
+
+__global__ void quantizeSinogram(const float* const __restrict__ sinogram,
+      short* __restrict__ quantized, const int* const __restrict__ maxAbs,
+      const int quantizationMax, const int size){
+
+   const float quantizationScale = quantizationMax / fmaxf(__int_as_float(*maxAbs), 1e-30f);
+
+   for(auto i = blockIdx.x * blockDim.x + threadIdx.x; i < size; i += blockDim.x * gridDim.x)
+      quantized[i] = __float2int_rn(sinogram[i] * quantizationScale);
+}
+
+template <int NumberOfPixels, int NumberOfProjections, int NumberOfDetectors>
+__global__ void backProjectFixedPoint(const short* const __restrict__ sinogram,
+      float* __restrict__ image, const int* const __restrict__ maxAbs,
+      const int quantizationMax, const int numberOfPixelsRuntime,
+      const int numberOfProjectionsRuntime, const int numberOfDetectorsRuntime){
+
+   const int numberOfPixels = geometry::select<NumberOfPixels>(numberOfPixelsRuntime);
+   const int numberOfProjections = geometry::select<NumberOfProjections>(numberOfProjectionsRuntime);
+   const int numberOfDetectors = geometry::select<NumberOfDetectors>(numberOfDetectorsRuntime);
+
+   const auto x = glados::cuda::getX();
+   const auto y = glados::cuda::getY();
+
+   if(x >= numberOfPixels || y >= numberOfPixels)
+      return;
+
+   int sum = 0;
+
+   const int centerIndex = numberOfDetectors * 0.5;
+
+   const float xp = (x - imageCenter[0]) * scale[0];
+   const float yp = (y - imageCenter[0]) * scale[0];
+
+#pragma unroll 16
+   for(auto projectionInd = 0; projectionInd < numberOfProjections; projectionInd++){
+      const float t = xp * cosLookup[projectionInd] + yp * sinLookup[projectionInd];
+      const int a = floor(t);
+      const int aCenter = a + centerIndex;
+      const int w1 = __float2int_rn((t - (float)a) * detail::fixedPointWeightScale);
+      const int w0 = detail::fixedPointWeightScale - w1;
+      const short* p = sinogram + projectionInd * numberOfDetectors + aCenter;
+      const int s0 = (aCenter >= 0 && aCenter < numberOfDetectors) ? p[0] : 0;
+      const int s1 = ((aCenter + 1) >= 0 && (aCenter + 1) < numberOfDetectors) ? p[1] : 0;
+#if __CUDA_ARCH__ >= 610
+      //two 16 bit samples times two 8 bit weights in one instruction
+      sum = __dp2a_lo((int)(((unsigned int)s1 << 16) | (s0 & 0xFFFF)), w0 | (w1 << 8), sum);
+#else
+      sum += w0 * s0 + w1 * s1;
+#endif
+   }
+   const float dequantizationScale = __int_as_float(*maxAbs)
+         / ((float)quantizationMax * detail::fixedPointWeightScale);
+   image[x + y * numberOfPixels] = sum * dequantizationScale * normalizationFactor[0];
+}
 
 }
 }
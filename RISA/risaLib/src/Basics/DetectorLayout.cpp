@@ -0,0 +1,90 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ *
+ */
+
+
+
+#include <risa/Basics/DetectorLayout.h>
+#include <risa/ConfigReader/ConfigReader.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <cstdlib>
+
+namespace risa {
+
+auto DetectorLayout::readConfig(const std::string& configFile) -> bool {
+   ConfigReader configReader = ConfigReader(configFile.data());
+   int numberOfFanDetectors, numberOfDetectorModules;
+   if (!configReader.lookupValue("numberOfFanDetectors", numberOfFanDetectors)
+         || !configReader.lookupValue("numberOfDetectorModules", numberOfDetectorModules))
+      return EXIT_FAILURE;
+
+   //the flat configuration values serve as defaults for the layout group
+   numberOfDetectorsPerModule_ = numberOfFanDetectors / numberOfDetectorModules;
+   configReader.lookupValue("numberOfDetectorsPerModule", numberOfDetectorsPerModule_);
+   configReader.lookupValue("detectorLayout.numberOfDetectorsPerModule", numberOfDetectorsPerModule_);
+
+   modules_.resize(configReader.lookupLength("detectorLayout.modules"));
+   for (auto i = 0u; i < modules_.size(); i++)
+      configReader.lookupValue("detectorLayout.modules", i, modules_[i]);
+   if (modules_.empty()) {
+      modules_.resize(numberOfDetectorModules);
+      for (auto i = 0u; i < modules_.size(); i++)
+         modules_[i] = i;
+   }
+
+   int basePort = 4000;
+   configReader.lookupValue("detectorLayout.basePort", basePort);
+   ports_.resize(configReader.lookupLength("detectorLayout.ports"));
+   for (auto i = 0u; i < ports_.size(); i++)
+      configReader.lookupValue("detectorLayout.ports", i, ports_[i]);
+   if (ports_.empty()) {
+      for (auto module : modules_)
+         ports_.push_back(basePort + module);
+   }
+
+   if (ports_.size() != modules_.size()) {
+      BOOST_LOG_TRIVIAL(error) << "recoLib::DetectorLayout: The number of ports does not match the number of modules.";
+      return EXIT_FAILURE;
+   }
+   if (numberOfDetectorsPerModule_ <= 0 || numberOfDetectors() != numberOfFanDetectors) {
+      BOOST_LOG_TRIVIAL(error) << "recoLib::DetectorLayout: The modules contain " << numberOfDetectors()
+            << " detectors, but numberOfFanDetectors is " << numberOfFanDetectors << ".";
+      return EXIT_FAILURE;
+   }
+
+   //the defect detectors are interpolated in the reordered sinogram, which requires the reordering stage
+   bool interpolateDefectDetectors = false;
+   configReader.lookupValue("fuseReordering", fuseReordering_);
+   configReader.lookupValue("interpolateDefectDetectors", interpolateDefectDetectors);
+   if (fuseReordering_ && interpolateDefectDetectors) {
+      BOOST_LOG_TRIVIAL(error) << "recoLib::DetectorLayout: Defect detector interpolation requires the reordering stage, "
+            << "fuseReordering and interpolateDefectDetectors cannot be enabled together.";
+      return EXIT_FAILURE;
+   }
+   BOOST_LOG_TRIVIAL(debug) << "recoLib::DetectorLayout: " << numberOfModules() << " modules with "
+         << numberOfDetectorsPerModule_ << " detectors each.";
+   return EXIT_SUCCESS;
+}
+
+}
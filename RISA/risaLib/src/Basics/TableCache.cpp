@@ -0,0 +1,185 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ *
+ */
+
+
+#include <risa/Basics/TableCache.h>
+
+#include <glados/Filesystem.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace risa {
+
+namespace {
+
+//increase, if the file layout changes
+constexpr std::uint32_t fileVersion = 1u;
+constexpr char fileMagic[8] = {'R', 'I', 'S', 'A', 'T', 'B', 'L', '\0'};
+constexpr std::size_t alignment = 64u;
+
+struct FileHeader {
+   char magic[8];
+   std::uint32_t version;
+   std::uint32_t numberOfTables;
+   std::uint64_t key;
+};
+
+struct TableEntry {
+   std::uint64_t offset;
+   std::uint64_t bytes;
+   std::uint64_t elementSize;
+};
+
+auto alignUp(std::size_t value) -> std::size_t {
+   return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+auto TableCache::Key::addBytes(const void* data, std::size_t size) -> Key& {
+   auto bytes = static_cast<const unsigned char*>(data);
+   for(auto i = 0u; i < size; i++){
+      hash_ ^= bytes[i];
+      hash_ *= 1099511628211ull;
+   }
+   return *this;
+}
+
+TableCache::TableCache(const std::string& directory, const std::string& name, const Key& key)
+   : directory_(directory), key_(key.value()) {
+   std::ostringstream fileName;
+   fileName << directory_ << "/" << name << "_" << std::hex << key_ << ".bin";
+   fileName_ = fileName.str();
+}
+
+TableCache::~TableCache() {
+   if(mapping_ != nullptr)
+      munmap(mapping_, mappingSize_);
+}
+
+auto TableCache::load() -> bool {
+   if(!enabled())
+      return false;
+
+   auto fd = open(fileName_.c_str(), O_RDONLY);
+   if(fd < 0)
+      return false;
+   struct stat fileStatus;
+   if(fstat(fd, &fileStatus) != 0 || fileStatus.st_size < (off_t)sizeof(FileHeader)){
+      close(fd);
+      return false;
+   }
+   mappingSize_ = fileStatus.st_size;
+   mapping_ = mmap(nullptr, mappingSize_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+   close(fd);
+   if(mapping_ == MAP_FAILED){
+      mapping_ = nullptr;
+      return false;
+   }
+
+   auto header = static_cast<const FileHeader*>(mapping_);
+   if(std::memcmp(header->magic, fileMagic, sizeof(fileMagic)) != 0 || header->version != fileVersion
+         || header->key != key_
+         || mappingSize_ < sizeof(FileHeader) + header->numberOfTables * sizeof(TableEntry)){
+      BOOST_LOG_TRIVIAL(warning) << "risa::TableCache: Ignoring invalid cache file " << fileName_ << ".";
+      munmap(mapping_, mappingSize_);
+      mapping_ = nullptr;
+      return false;
+   }
+   BOOST_LOG_TRIVIAL(info) << "risa::TableCache: Loaded lookup tables from " << fileName_ << ".";
+   return true;
+}
+
+auto TableCache::table(std::size_t index, std::size_t size, std::size_t elementSize) const -> const void* {
+   if(mapping_ == nullptr)
+      return nullptr;
+   auto header = static_cast<const FileHeader*>(mapping_);
+   if(index >= header->numberOfTables)
+      return nullptr;
+   auto entry = reinterpret_cast<const TableEntry*>(header + 1) + index;
+   if(entry->elementSize != elementSize || entry->bytes != size * elementSize
+         || entry->offset + entry->bytes > mappingSize_)
+      return nullptr;
+   return static_cast<const char*>(mapping_) + entry->offset;
+}
+
+auto TableCache::store() -> void {
+   if(!enabled())
+      return;
+   try {
+      if(!glados::createDirectory(directory_))
+         return;
+   } catch (const std::runtime_error& err) {
+      BOOST_LOG_TRIVIAL(warning) << "risa::TableCache: " << err.what();
+      return;
+   }
+
+   FileHeader header;
+   std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+   header.version = fileVersion;
+   header.numberOfTables = tables_.size();
+   header.key = key_;
+
+   std::vector<TableEntry> entries(tables_.size());
+   auto offset = alignUp(sizeof(FileHeader) + entries.size() * sizeof(TableEntry));
+   for(auto i = 0u; i < tables_.size(); i++){
+      entries[i] = TableEntry{offset, tables_[i].bytes, tables_[i].elementSize};
+      offset = alignUp(offset + tables_[i].bytes);
+   }
+
+   const auto tmpFileName = fileName_ + ".tmp." + std::to_string(getpid());
+   {
+      std::ofstream file(tmpFileName, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(TableEntry));
+      const char padding[alignment] = {};
+      for(auto i = 0u; i < tables_.size(); i++){
+         file.write(padding, entries[i].offset - file.tellp());
+         file.write(static_cast<const char*>(tables_[i].data), tables_[i].bytes);
+      }
+      if(!file){
+         BOOST_LOG_TRIVIAL(warning) << "risa::TableCache: Could not write cache file " << tmpFileName << ".";
+         std::remove(tmpFileName.c_str());
+         return;
+      }
+   }
+   if(std::rename(tmpFileName.c_str(), fileName_.c_str()) != 0){
+      BOOST_LOG_TRIVIAL(warning) << "risa::TableCache: Could not create cache file " << fileName_ << ".";
+      std::remove(tmpFileName.c_str());
+      return;
+   }
+   BOOST_LOG_TRIVIAL(info) << "risa::TableCache: Stored lookup tables in " << fileName_ << ".";
+}
+
+}
@@ -21,14 +21,12 @@
  *
  */
 
-#include "interpolationFunctions.h"
-
 #include <risa/DetectorInterpolation/DetectorInterpolation.h>
 #include <risa/ConfigReader/ConfigReader.h>
 
 #include <glados/cuda/Coordinates.h>
 #include <glados/cuda/Check.h>
-#include <glados/MemoryPool.h>
+#include <glados/cuda/Memory.h>
 
 #include <boost/log/trivial.hpp>
 
@@ -43,6 +41,13 @@
 namespace risa {
 namespace cuda {
 
+//! the number of detectors processed by one block of the variation kernel
+constexpr int detectorsPerBlock = 32;
+//! the number of threads sharing the projections of one detector in the variation kernel
+constexpr int threadsPerDetector = 8;
+//! the number of neighbours on each side, that are used for the threshold of a detector
+constexpr int filterHalfWidth = 9;
+
 DetectorInterpolation::DetectorInterpolation(const std::string& configFile){
 
    if (readConfig(configFile)) {
@@ -52,7 +57,7 @@ DetectorInterpolation::DetectorInterpolation(const std::string& configFile){
 
    CHECK(cudaGetDeviceCount(&numberOfDevices_));
    for(auto i = 0; i < numberOfDevices_; i++){
-      memoryPoolIdxs_[i] = glados::MemoryPool<glados::cuda::HostMemoryManager<unsigned short, glados::cuda::async_copy_policy>>::instance()->registerStage(500, numberOfDetectors_*numberOfProjections_);
+      CHECK(cudaSetDevice(i));
       //custom streams are necessary, because profiling with nvprof seems to be
       //not possible with -default-stream per-thread option
       cudaStream_t stream;
@@ -70,6 +75,10 @@ DetectorInterpolation::DetectorInterpolation(const std::string& configFile){
 }
 
 DetectorInterpolation::~DetectorInterpolation() {
+   for (auto i = 0; i < numberOfDevices_; i++) {
+      CHECK(cudaSetDevice(i));
+      CHECK(cudaStreamDestroy(streams_[i]));
+   }
    for(auto id: defects_){
       BOOST_LOG_TRIVIAL(info) << "Defects: " << id;
    }
@@ -106,36 +115,92 @@ auto DetectorInterpolation::processor(int deviceID) -> void {
    //nvtxNameOsThreadA(pthread_self(), "DetectorInterpolation");
    CHECK(cudaSetDevice(deviceID));
    BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::DetectorInterpolation: Running Thread for Device " << deviceID;
-   std::vector<double> filterFunction{0.5, 1.0, 1.0, 1.0, 1.5, 2.0, 3.0, 3.5, 2.0, 3.5, 3.0, 2.0, 1.5, 1.0, 1.0, 1.0, 0.5};
-   double sum = std::accumulate(filterFunction.cbegin(), filterFunction.cend(), 0.0);
+   std::vector<float> filterFunction{0.5, 1.0, 1.0, 1.0, 1.5, 2.0, 3.0, 3.5, 2.0, 3.5, 3.0, 2.0, 1.5, 1.0, 1.0, 1.0, 0.5};
+   float sum = std::accumulate(filterFunction.cbegin(), filterFunction.cend(), 0.0f);
    std::transform(filterFunction.begin(), filterFunction.end(), filterFunction.begin(),
-         std::bind1st(std::multiplies<double>(), 1.0/sum));
+         std::bind1st(std::multiplies<float>(), 1.0f/sum));
+
+   auto filterFunction_d = glados::cuda::make_device_ptr<float>(filterFunction.size());
+   auto variation_d = glados::cuda::make_device_ptr<float>(numberOfDetectors_);
+   auto drift_d = glados::cuda::make_device_ptr<int>(1);
+   //statistics and defect lists are kept per plane
+   const auto planeSize = numberOfPlanes_ * numberOfDetectors_;
+   auto mean_d = glados::cuda::make_device_ptr<float>(planeSize);
+   auto m2_d = glados::cuda::make_device_ptr<float>(planeSize);
+   auto referenceMean_d = glados::cuda::make_device_ptr<float>(planeSize);
+   auto referenceStd_d = glados::cuda::make_device_ptr<float>(planeSize);
+   auto defects_d = glados::cuda::make_device_ptr<int>(planeSize);
+   auto leftDistance_d = glados::cuda::make_device_ptr<int>(planeSize);
+   auto rightDistance_d = glados::cuda::make_device_ptr<int>(planeSize);
+   CHECK(cudaMemcpyAsync(filterFunction_d.get(), filterFunction.data(), sizeof(float)*filterFunction.size(),
+         cudaMemcpyHostToDevice, streams_[deviceID]));
+   CHECK(cudaMemsetAsync(mean_d.get(), 0, sizeof(float)*planeSize, streams_[deviceID]));
+   CHECK(cudaMemsetAsync(m2_d.get(), 0, sizeof(float)*planeSize, streams_[deviceID]));
+   CHECK(cudaMemsetAsync(referenceStd_d.get(), 0, sizeof(float)*planeSize, streams_[deviceID]));
+   CHECK(cudaMemsetAsync(defects_d.get(), 0, sizeof(int)*planeSize, streams_[deviceID]));
+   //number of sinograms in the running statistics, zero until the first evaluation
+   std::vector<int> count(numberOfPlanes_, 0);
+   std::vector<bool> evaluated(numberOfPlanes_, false);
+   int drift = 0;
+
+   dim3 blocksVariation(detectorsPerBlock, threadsPerDetector);
+   dim3 gridsVariation(std::ceil(numberOfDetectors_/(float)detectorsPerBlock));
+   dim3 blocks1D(128);
+   dim3 grids1D(std::ceil(numberOfDetectors_/128.0));
+   dim3 blocks2D(32, 8);
+   dim3 grids2D(std::ceil(numberOfDetectors_/32.0), std::ceil(numberOfProjections_/8.0));
+
    while (true) {
       auto sinogram = sinograms_[deviceID].take();
       if (!sinogram.valid())
          break;
 
-      BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::DetectorInterpolation: Copy sinogram " << sinogram.index() << " to device " << deviceID;
-
-      auto h_sino = glados::MemoryPool<glados::cuda::HostMemoryManager<unsigned short, glados::cuda::async_copy_policy>>::instance()->requestMemory(memoryPoolIdxs_[deviceID]);
-
-      CHECK(cudaMemcpyAsync(h_sino.container().get(), sinogram.container().get(), sizeof(unsigned short)*numberOfProjections_*numberOfDetectors_, cudaMemcpyDeviceToHost, streams_[deviceID]));
-
-      CHECK(cudaStreamSynchronize(streams_[deviceID]));
-
-      std::vector<int> defectDetectors(numberOfDetectors_, 0);
+      BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::DetectorInterpolation: Interpolating sinogram " << sinogram.index() << " on device " << deviceID;
+
+      const auto plane = sinogram.plane();
+      const auto offset = plane * numberOfDetectors_;
+      detectorVariation<<<gridsVariation, blocksVariation, 0, streams_[deviceID]>>>(sinogram.container().get(),
+            variation_d.get(), numberOfDetectors_, numberOfProjections_);
+      CHECK(cudaPeekAtLastError());
+      count[plane]++;
+      CHECK(cudaMemsetAsync(drift_d.get(), 0, sizeof(int), streams_[deviceID]));
+      updateVariationStatistics<<<grids1D, blocks1D, 0, streams_[deviceID]>>>(variation_d.get(), mean_d.get() + offset,
+            m2_d.get() + offset, referenceMean_d.get() + offset, referenceStd_d.get() + offset, defects_d.get() + offset,
+            drift_d.get(), count[plane], numberOfDetectors_, defectDriftThreshold_);
+      CHECK(cudaPeekAtLastError());
+      if (defectDriftThreshold_ > 0.f && evaluated[plane]) {
+         CHECK(cudaMemcpyAsync(&drift, drift_d.get(), sizeof(int), cudaMemcpyDeviceToHost, streams_[deviceID]));
+         CHECK(cudaStreamSynchronize(streams_[deviceID]));
+      }
 
-      findDefectDetectors(h_sino.container().get(), filterFunction, defectDetectors, numberOfDetectors_, numberOfProjections_,
-            threshMin_, threshMax_);
+      //evaluate the defect mask on the mean variation of the last sinograms of this plane
+      if (!evaluated[plane] || count[plane] >= defectDetectionInterval_ || drift > 0) {
+         if (drift > 0)
+            BOOST_LOG_TRIVIAL(debug) << "recoLib::cuda::DetectorInterpolation: " << drift << " detectors in plane " << plane << " drifted.";
+         CHECK(cudaMemsetAsync(defects_d.get() + offset, 0, sizeof(int)*numberOfDetectors_, streams_[deviceID]));
+         markDefectDetectors<<<grids1D, blocks1D, 0, streams_[deviceID]>>>(mean_d.get() + offset, filterFunction_d.get(),
+               defects_d.get() + offset, numberOfDetectors_, threshMin_, threshMax_);
+         CHECK(cudaPeekAtLastError());
+         findWorkingNeighbours<<<grids1D, blocks1D, 0, streams_[deviceID]>>>(defects_d.get() + offset, leftDistance_d.get() + offset,
+               rightDistance_d.get() + offset, numberOfDetectors_);
+         CHECK(cudaPeekAtLastError());
+         restartVariationStatistics<<<grids1D, blocks1D, 0, streams_[deviceID]>>>(mean_d.get() + offset, m2_d.get() + offset,
+               referenceMean_d.get() + offset, referenceStd_d.get() + offset, count[plane], numberOfDetectors_);
+         CHECK(cudaPeekAtLastError());
+         count[plane] = 0;
+         evaluated[plane] = true;
+         drift = 0;
+      }
 
-      interpolateDefectDetectors(h_sino.container().get(), defectDetectors, numberOfDetectors_, numberOfProjections_);
+      interpolateDefects<<<grids2D, blocks2D, 0, streams_[deviceID]>>>(sinogram.container().get(), leftDistance_d.get() + offset,
+            rightDistance_d.get() + offset, numberOfDetectors_, numberOfProjections_);
+      CHECK(cudaPeekAtLastError());
 
-      CHECK(cudaMemcpyAsync(sinogram.container().get(), h_sino.container().get(),
-                   sinogram.size() * sizeof(unsigned short), cudaMemcpyHostToDevice, streams_[deviceID]));
+      //wait until work on device is finished
       CHECK(cudaStreamSynchronize(streams_[deviceID]));
       results_.push(std::move(sinogram));
 
-      BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::DetectorInterpolation: Copy sinogram " << sinogram.index() << " to device finished.";
+      BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::DetectorInterpolation: Interpolating sinogram " << sinogram.index() << " finished.";
    }
 }
 
@@ -146,8 +211,13 @@ auto DetectorInterpolation::readConfig(const std::string& configFile) -> bool {
          && configReader.lookupValue("thresh_min", threshMin_)
          && configReader.lookupValue("thresh_max", threshMax_)
          && configReader.lookupValue("samplingRate", samplingRate)
-         && configReader.lookupValue("scanRate", scanRate)){
+         && configReader.lookupValue("scanRate", scanRate)
+         && configReader.lookupValue("numberOfPlanes", numberOfPlanes_)){
       numberOfProjections_ = samplingRate * 1000000 / scanRate;
+      //optional parameters, by default the defect mask is evaluated for every sinogram
+      configReader.lookupValue("defectDetectionInterval", defectDetectionInterval_);
+      configReader.lookupValue("defectDriftThreshold", defectDriftThreshold_);
+      defectDetectionInterval_ = std::max(defectDetectionInterval_, 1);
       return EXIT_SUCCESS;
    }
    else
@@ -155,5 +225,146 @@ auto DetectorInterpolation::readConfig(const std::string& configFile) -> bool {
 
 }
 
+__global__ void detectorVariation(const unsigned short* __restrict__ sinogram, float* __restrict__ variation,
+      const int numberOfDetectors, const int numberOfProjections) {
+   __shared__ float totalVariation[threadsPerDetector][detectorsPerBlock];
+   __shared__ float minValue[threadsPerDetector][detectorsPerBlock];
+   __shared__ float maxValue[threadsPerDetector][detectorsPerBlock];
+
+   const int detInd = blockIdx.x * blockDim.x + threadIdx.x;
+   const int tx = threadIdx.x;
+   const int ty = threadIdx.y;
+
+   //like on the host, the last projection only contributes to the variation
+   float var = 0.f;
+   float varMin = 0.f, varMax = 0.f;
+   if (detInd < numberOfDetectors) {
+      varMin = varMax = sinogram[detInd];
+      for (int projInd = ty; projInd < numberOfProjections - 1; projInd += blockDim.y) {
+         const float value = sinogram[detInd + projInd * numberOfDetectors];
+         const float next = sinogram[detInd + (projInd + 1) * numberOfDetectors];
+         var += fabsf(value - next);
+         varMin = fminf(varMin, value);
+         varMax = fmaxf(varMax, value);
+      }
+   }
+   totalVariation[ty][tx] = var;
+   minValue[ty][tx] = varMin;
+   maxValue[ty][tx] = varMax;
+   __syncthreads();
+
+   for (int stride = blockDim.y / 2; stride > 0; stride /= 2) {
+      if (ty < stride) {
+         totalVariation[ty][tx] += totalVariation[ty + stride][tx];
+         minValue[ty][tx] = fminf(minValue[ty][tx], minValue[ty + stride][tx]);
+         maxValue[ty][tx] = fmaxf(maxValue[ty][tx], maxValue[ty + stride][tx]);
+      }
+      __syncthreads();
+   }
+
+   if (ty == 0 && detInd < numberOfDetectors) {
+      const float range = maxValue[0][tx] - minValue[0][tx];
+      variation[detInd] = totalVariation[0][tx] * range * range;
+   }
+}
+
+__global__ void updateVariationStatistics(const float* __restrict__ variation, float* __restrict__ mean,
+      float* __restrict__ m2, const float* __restrict__ referenceMean, const float* __restrict__ referenceStd,
+      const int* __restrict__ defects, int* __restrict__ drift, const int count,
+      const int numberOfDetectors, const float driftThreshold) {
+   const int detInd = glados::cuda::getX();
+   if (detInd >= numberOfDetectors)
+      return;
+
+   const float value = variation[detInd];
+   const float delta = value - mean[detInd];
+   const float newMean = mean[detInd] + delta / count;
+   mean[detInd] = newMean;
+   m2[detInd] += delta * (value - newMean);
+
+   if (driftThreshold > 0.f && !defects[detInd] && referenceStd[detInd] > 0.f
+         && fabsf(value - referenceMean[detInd]) > driftThreshold * referenceStd[detInd])
+      atomicAdd(drift, 1);
+}
+
+__global__ void restartVariationStatistics(float* __restrict__ mean, float* __restrict__ m2,
+      float* __restrict__ referenceMean, float* __restrict__ referenceStd, const int count,
+      const int numberOfDetectors) {
+   const int detInd = glados::cuda::getX();
+   if (detInd >= numberOfDetectors)
+      return;
+
+   referenceMean[detInd] = mean[detInd];
+   referenceStd[detInd] = count > 1 ? sqrtf(m2[detInd] / (count - 1)) : 0.f;
+   mean[detInd] = 0.f;
+   m2[detInd] = 0.f;
+}
+
+__global__ void markDefectDetectors(const float* __restrict__ variation, const float* __restrict__ filterFunction,
+      int* __restrict__ defects, const int numberOfDetectors, const float threshMin, const float threshMax) {
+   const int detInd = glados::cuda::getX();
+   const int numberOfSegmentDetectors = numberOfDetectors / 2;
+   if (detInd >= 2 * numberOfSegmentDetectors)
+      return;
+
+   //the two halves of the detector ring are treated separately
+   const int segmentStart = (detInd / numberOfSegmentDetectors) * numberOfSegmentDetectors;
+   const int i = detInd - segmentStart;
+   float threshSegment = 0.f;
+   for (int j = 0; j < filterHalfWidth; j++) {
+      threshSegment += filterFunction[j] * variation[segmentStart + (i + numberOfSegmentDetectors - j) % numberOfSegmentDetectors];
+      threshSegment += filterFunction[j] * variation[segmentStart + (i + j) % numberOfSegmentDetectors];
+   }
+
+   const int addNeighboursToFlickering = 2;
+   if (variation[detInd] < threshMin * threshSegment)
+      defects[detInd] = 1;
+   if (variation[detInd] > threshMax * threshSegment) {
+      for (int offset = -addNeighboursToFlickering; offset <= addNeighboursToFlickering; offset++)
+         defects[(detInd + numberOfDetectors + offset) % numberOfDetectors] = 1;
+   }
+}
+
+__global__ void findWorkingNeighbours(const int* __restrict__ defects, int* __restrict__ leftDistance,
+      int* __restrict__ rightDistance, const int numberOfDetectors) {
+   const int detInd = glados::cuda::getX();
+   if (detInd >= numberOfDetectors)
+      return;
+
+   int left = 0, right = 0;
+   if (defects[detInd]) {
+      left = 1;
+      while (left < numberOfDetectors && defects[(detInd + numberOfDetectors - left) % numberOfDetectors])
+         left++;
+      right = 1;
+      while (right < numberOfDetectors && defects[(detInd + right) % numberOfDetectors])
+         right++;
+      //no working detector at all, leave the values untouched
+      if (left == numberOfDetectors)
+         left = right = 0;
+   }
+   leftDistance[detInd] = left;
+   rightDistance[detInd] = right;
+}
+
+__global__ void interpolateDefects(unsigned short* __restrict__ sinogram, const int* __restrict__ leftDistance,
+      const int* __restrict__ rightDistance, const int numberOfDetectors, const int numberOfProjections) {
+   const int detInd = glados::cuda::getX();
+   const int projInd = glados::cuda::getY();
+   if (detInd >= numberOfDetectors || projInd >= numberOfProjections)
+      return;
+
+   const int left = leftDistance[detInd];
+   if (left == 0)
+      return;
+   const int right = rightDistance[detInd];
+
+   unsigned short* projection = sinogram + projInd * numberOfDetectors;
+   const float w1 = left / (float) (left + right);
+   const float w0 = 1.f - w1;
+   projection[detInd] = w0 * projection[(detInd + numberOfDetectors - left) % numberOfDetectors]
+         + w1 * projection[(detInd + right) % numberOfDetectors];
+}
+
 }
 }
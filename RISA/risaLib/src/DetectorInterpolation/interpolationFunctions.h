@@ -24,6 +24,7 @@
 #define INTERPOLATIONFUNCTIONS_H_
 
 #include <vector>
+#include <cmath>
 
 template <typename T>
 auto findDefectDetectors(T* data, std::vector<double>& filterFunction, std::vector<int>& defectDetectors,
@@ -50,7 +51,7 @@ auto findDefectDetectors(T* data, std::vector<double>& filterFunction, std::vect
       for(auto i = 0u; i < numberOfDetectors/2; i++){
          double thresh_segment = 0.0;
          for(auto j = 0; j < 9; j++){
-            int ind = (i - j) % (numberOfDetectors/2);
+            int ind = (i + numberOfDetectors/2 - j) % (numberOfDetectors/2);
             thresh_segment += filterFunction[j] * var[ind + detectorSeg * (numberOfDetectors/2)];
             ind = (i + j) % (numberOfDetectors/2);
             thresh_segment += filterFunction[j] * var[ind + detectorSeg * (numberOfDetectors/2)];
@@ -62,7 +63,7 @@ auto findDefectDetectors(T* data, std::vector<double>& filterFunction, std::vect
          }
          if(var[detInd] > threshMax * thresh_segment){
             for(int offset = -addNeighboursToFlickering; offset <= addNeighboursToFlickering; offset++){
-               defectDetectors[(detInd+offset)%numberOfDetectors] = 1;
+               defectDetectors[(detInd+numberOfDetectors+offset)%numberOfDetectors] = 1;
                //std::cout << "Defect: " << (detInd+offset)%numberOfDetectors_ << std::endl;
             }
          }
@@ -73,28 +74,28 @@ auto findDefectDetectors(T* data, std::vector<double>& filterFunction, std::vect
 template <typename T>
 auto interpolateDefectDetectors(T* data, std::vector<int>& defectDetectors,
       unsigned int numberOfDetectors, unsigned int numberOfProjections) -> void {
-   unsigned int detID = 0;
-   //interpolate
-   while(detID < numberOfDetectors){
-      if(defectDetectors[detID]){
-         unsigned int det0 = detID;
-         //BOOST_LOG_TRIVIAL(info) << "Interpolation from " << det0;
-         while(defectDetectors[detID] && defectDetectors[(detID+1)%numberOfDetectors]){
-            detID++;
-         }
-         //BOOST_LOG_TRIVIAL(info) << "to " << detID;
-         for(auto i = det0; i <= detID; i++){
-            float w1 = ((float)i - (float)det0 + 1.0)/((float)detID - (float)det0 + 2.0);
-            float w0 = 1.0 - w1;
-            for(auto projId = 0u; projId < numberOfProjections; projId++){
-               data[(i%numberOfDetectors) + projId*numberOfDetectors] = w0 * data[(det0-1)%numberOfDetectors + projId*numberOfDetectors] +
-                              w1 * data[(detID+1)%numberOfDetectors + projId*numberOfDetectors];
-            }
-         }
+   //interpolate between the closest working detectors on both sides, the search wraps around
+   //the detector ring in the same way as findWorkingNeighbours on the device
+   for(auto detID = 0u; detID < numberOfDetectors; detID++){
+      if(!defectDetectors[detID])
+         continue;
+      unsigned int left = 1;
+      while(left < numberOfDetectors && defectDetectors[(detID + numberOfDetectors - left) % numberOfDetectors])
+         left++;
+      //no working detector at all, leave the values untouched
+      if(left == numberOfDetectors)
+         return;
+      unsigned int right = 1;
+      while(defectDetectors[(detID + right) % numberOfDetectors])
+         right++;
+      const float w1 = left / (float)(left + right);
+      const float w0 = 1.f - w1;
+      for(auto projId = 0u; projId < numberOfProjections; projId++){
+         T* projection = data + projId*numberOfDetectors;
+         projection[detID] = w0 * projection[(detID + numberOfDetectors - left) % numberOfDetectors]
+               + w1 * projection[(detID + right) % numberOfDetectors];
       }
-      detID++;
    }
 }
 
-
 #endif /* INTERPOLATIONFUNCTIONS_H_ */
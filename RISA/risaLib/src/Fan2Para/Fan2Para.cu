@@ -34,13 +34,19 @@
 
 #include <nvToolsExt.h>
 
+#include <algorithm>
 #include <exception>
+#include <limits>
+#include <utility>
 #include <vector>
 #include <pthread.h>
 
 namespace risa {
 namespace cuda {
 
+//! increase, if the computation of the hash table changes, to invalidate cached tables
+constexpr int hashTableVersion = 2;
+
 Fan2Para::Fan2Para(const std::string& configFile) {
    if (readConfig(configFile)) {
       throw std::runtime_error(
@@ -49,69 +55,36 @@ Fan2Para::Fan2Para(const std::string& configFile) {
 
    CHECK(cudaGetDeviceCount(&numberOfDevices_));
 
-   auto dataSetSize = params_.numberOfParallelDetectors_
-         * params_.numberOfParallelProjections_ * params_.numberOfPlanes_;
-
-   //allocate memory for hash table on each device
-   for (auto i = 0; i < numberOfDevices_; i++) {
-      CHECK(cudaSetDevice(i));
-      theta_d_[i] = std::move(
-            glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(
-                  params_.numberOfFanProjections_));
-      gamma_d_[i] = std::move(
-            glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(
-                  params_.numberOfFanDetectors_));
-      s_d_[i] = std::move(
-            glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(
-                  params_.numberOfParallelDetectors_));
-      alphaCircle_d_[i] = std::move(
-            glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(
-                  params_.numberOfParallelProjections_));
-      thetaAfterRay1_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      thetaAfterRay2_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      thetaBeforeRay1_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      thetaBeforeRay2_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      gammaAfterRay1_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      gammaAfterRay2_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      gammaBeforeRay1_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      gammaBeforeRay2_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      gammaGoalRay1_d_[i] = std::move(
-            glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      gammaGoalRay2_d_[i] = std::move(
-            glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      thetaGoalRay1_d_[i] = std::move(
-            glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      thetaGoalRay2_d_[i] = std::move(
-            glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      ray1_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
-      ray2_d_[i] = std::move(
-            glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(
-                  dataSetSize));
+   //the hash table only depends on the geometry, reuse it from the cache if possible
+   TableCache::Key key;
+   key.add(hashTableVersion).add(params_.numberOfPlanes_).add(params_.numberOfFanDetectors_)
+      .add(params_.numberOfFanProjections_).add(params_.numberOfParallelProjections_)
+      .add(params_.numberOfParallelDetectors_).add(params_.sourceOffset_).add(params_.rDetector_)
+      .add(params_.imageCenterX_).add(params_.imageCenterY_).add(params_.imageWidth_);
+   for (auto i = 0; i < params_.numberOfPlanes_; i++)
+      key.add(rTarget_[i]).add(deltaX_[i]).add(deltaZ_[i]).add(sourceAngle_[i]);
+   TableCache cache(tableCacheDirectory_, "fan2para", key);
+   if (!cache.load() || !loadFan2ParaTransp(cache)) {
+      computeFan2ParaTransp();
+      storeFan2ParaTransp(cache);
    }
 
-   computeFan2ParaTransp();
+   computePackedTable();
+
+   if (rebinningMethod_ == detail::RebinningMethod::hashTable) {
+      for (auto i = 0; i < numberOfDevices_; i++) {
+         CHECK(cudaSetDevice(i));
+         packedTable_d_[i] = glados::cuda::make_device_ptr<char, glados::cuda::async_copy_policy>(packedTable_.size());
+      }
+   } else if (rebinningMethod_ == detail::RebinningMethod::sparseMatrix) {
+      computeSparseMatrix();
+      for (auto i = 0; i < numberOfDevices_; i++) {
+         CHECK(cudaSetDevice(i));
+         csrRowPtr_d_[i] = glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(csrRowPtr_.size());
+         csrColInd_d_[i] = glados::cuda::make_device_ptr<int, glados::cuda::async_copy_policy>(csrColInd_.size());
+         csrValues_d_[i] = glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(csrValues_.size());
+      }
+   }
 
    for (auto i = 0; i < numberOfDevices_; i++) {
       CHECK(cudaSetDevice(i));
@@ -190,22 +163,24 @@ auto Fan2Para::processor(const int deviceID) -> void {
    //nvtxNameOsThreadA(pthread_self(), "Fan2Para");
    CHECK(cudaSetDevice(deviceID));
    dim3 blocks2D(blockSize2D_, blockSize2D_);
+   //one thread per bin of the 180 degree parallel beam sinogram
    dim3 grids2D(
          std::ceil(params_.numberOfParallelDetectors_ / (float) blockSize2D_),
          std::ceil(
-               params_.numberOfParallelProjections_ / (float) blockSize2D_));
+               params_.numberOfParallelProjections_ / 2 / (float) blockSize2D_));
    dim3 blocks1D(blockSize1D_);
-   dim3 grids1D(
-         std::ceil(
-               params_.numberOfParallelProjections_
-                     * params_.numberOfParallelDetectors_
-                     / (float) blockSize1D_));
-   auto params_d = glados::cuda::make_device_ptr<parameters>(1);
-   CHECK(
-         cudaMemcpyAsync(params_d.get(), &params_, sizeof(parameters),
-               cudaMemcpyHostToDevice, streams_[deviceID]));
-   CHECK(cudaStreamSynchronize(streams_[deviceID]));
-   CHECK(cudaFuncSetCacheConfig(interpolation, cudaFuncCachePreferL1));
+   const int numberOfRows = params_.numberOfParallelProjections_ * params_.numberOfParallelDetectors_ / 2;
+   dim3 gridsSparse(std::ceil(numberOfRows / (float) blockSize1D_));
+   //the number of parallel projections is doubled for 360 degrees in readConfig()
+   const bool useSpecializedKernel = params_.numberOfFanDetectors_ == geometry::numberOfFanDetectors
+         && params_.numberOfParallelDetectors_ == geometry::numberOfParallelDetectors
+         && params_.numberOfParallelProjections_ == 2 * geometry::numberOfParallelProjections;
+   const auto interpolationKernel = geometry::selectKernel(useSpecializedKernel,
+         interpolation<geometry::numberOfFanDetectors, geometry::numberOfParallelDetectors,
+            2 * geometry::numberOfParallelProjections, fanSinogram_type>,
+         interpolation<0, 0, 0, fanSinogram_type>);
+   BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::Fan2Para: Using " << (useSpecializedKernel ? "specialized" : "generic") << " interpolation kernel.";
+   CHECK(cudaFuncSetCacheConfig(interpolationKernel, cudaFuncCachePreferL1));
    BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::Fan2Para: Running Thread for Device " << deviceID;
    while (true) {
       auto sinogram = fanSinograms_[deviceID].take();
@@ -217,25 +192,26 @@ auto Fan2Para::processor(const int deviceID) -> void {
       auto img = glados::MemoryPool<deviceManagerType>::instance()->requestMemory(
             memoryPoolIdxs_[deviceID]);
 
-      setValue<float> <<<grids1D, blocks1D, 0, streams_[deviceID]>>>(
-            img.container().get(), 0.0, img.size());
-      CHECK(cudaPeekAtLastError());
+      if(rebinningMethod_ == detail::RebinningMethod::sparseMatrix){
+         rebinSparse<<<gridsSparse, blocks1D, 0, streams_[deviceID]>>>(
+               sinogram.container().get(), img.container().get(),
+               csrRowPtr_d_[deviceID].get() + sinogram.plane() * numberOfRows,
+               csrColInd_d_[deviceID].get(), csrValues_d_[deviceID].get(), numberOfRows);
+         CHECK(cudaPeekAtLastError());
+         img.setDevice(deviceID);
+         img.setIdx(sinogram.index());
+         img.setPlane(sinogram.plane());
+         img.setStart(sinogram.start());
+         //wait until work on device is finished
+         CHECK(cudaStreamSynchronize(streams_[deviceID]));
+         results_.push(std::move(img));
+         continue;
+      }
 
-      interpolation<<<grids2D, blocks2D, 0, streams_[deviceID]>>>(
-            sinogram.plane(), sinogram.container().get(), img.container().get(),
-            gamma_d_[deviceID].get(), theta_d_[deviceID].get(),
-            alphaCircle_d_[deviceID].get(), s_d_[deviceID].get(),
-            thetaAfterRay1_d_[deviceID].get(),
-            thetaAfterRay2_d_[deviceID].get(),
-            thetaBeforeRay1_d_[deviceID].get(),
-            thetaBeforeRay2_d_[deviceID].get(),
-            gammaBeforeRay1_d_[deviceID].get(),
-            gammaBeforeRay2_d_[deviceID].get(),
-            gammaAfterRay1_d_[deviceID].get(),
-            gammaAfterRay2_d_[deviceID].get(), thetaGoalRay1_d_[deviceID].get(),
-            thetaGoalRay2_d_[deviceID].get(), gammaGoalRay1_d_[deviceID].get(),
-            gammaGoalRay2_d_[deviceID].get(), ray1_d_[deviceID].get(),
-            ray2_d_[deviceID].get(), params_d.get());
+      const char* table = packedTable_d_[deviceID].get() + sinogram.plane() * packedPlaneSize_;
+      interpolationKernel<<<grids2D, blocks2D, 0, streams_[deviceID]>>>(
+            table, sinogram.container().get(), img.container().get(), params_.numberOfFanDetectors_,
+            params_.numberOfParallelDetectors_, params_.numberOfParallelProjections_);
       CHECK(cudaPeekAtLastError());
       img.setDevice(deviceID);
       img.setIdx(sinogram.index());
@@ -252,29 +228,7 @@ auto Fan2Para::computeFan2ParaTransp() -> void {
 
    BOOST_LOG_TRIVIAL(info)<< "Computing Hash Table for conversion from fan to parallel beam.";
 
-   auto dataSetSize = params_.numberOfParallelProjections_ * params_.numberOfParallelDetectors_
-   * params_.numberOfPlanes_;
-
-   //allocate memory on host
-   theta_.resize(params_.numberOfFanProjections_);
-   gamma_.resize(params_.numberOfFanDetectors_);
-   s_.resize(params_.numberOfParallelDetectors_);
-   alphaCircle_.resize(params_.numberOfParallelProjections_);
-
-   thetaAfterRay1_.resize(dataSetSize);
-   thetaAfterRay2_.resize(dataSetSize);
-   thetaBeforeRay1_.resize(dataSetSize);
-   thetaBeforeRay2_.resize(dataSetSize);
-   gammaAfterRay1_.resize(dataSetSize);
-   gammaAfterRay2_.resize(dataSetSize);
-   gammaBeforeRay1_.resize(dataSetSize);
-   gammaBeforeRay2_.resize(dataSetSize);
-   gammaGoalRay1_.resize(dataSetSize);
-   gammaGoalRay2_.resize(dataSetSize);
-   thetaGoalRay1_.resize(dataSetSize);
-   thetaGoalRay2_.resize(dataSetSize);
-   ray1_.resize(dataSetSize);
-   ray2_.resize(dataSetSize);
+   allocateFan2ParaTransp();
 
    // === Init values for Hash table
    // ===============================
@@ -289,6 +243,7 @@ auto Fan2Para::computeFan2ParaTransp() -> void {
       theta_[j] = theta_[j] + 360.0;
       theta_[j] = ((2 * M_PI) / 360.0) * theta_[j];
    }
+   thetaMinIdx_ = std::min_element(theta_.cbegin(), theta_.cend()) - theta_.cbegin();
 
    gamma_[0] = 0.0;
    for (auto j = 1; j < params_.numberOfFanDetectors_; j++) {
@@ -310,8 +265,6 @@ auto Fan2Para::computeFan2ParaTransp() -> void {
 
    // === calculate Hash Table
    // =========================
-   unsigned long long ind = 0;
-   int i, j, k;
    float kappa = 0, L = 0;
    float tb = 0.0;
 
@@ -334,14 +287,15 @@ auto Fan2Para::computeFan2ParaTransp() -> void {
 
    unsigned int parallelSize = params_.numberOfParallelDetectors_
    * params_.numberOfParallelProjections_;
-   float temp_1;
 
-   for (k = 0; k < params_.numberOfPlanes_; k++) {
-      for (j = 0; j < params_.numberOfParallelProjections_; j++) {
-         for (i = 0; i < params_.numberOfParallelDetectors_; i++) {
+   //every bin only writes its own table entries, planes and projections are processed in parallel
+#pragma omp parallel for collapse(2) schedule(static)
+   for (auto k = 0; k < params_.numberOfPlanes_; k++) {
+      for (auto j = 0; j < params_.numberOfParallelProjections_; j++) {
+         for (auto i = 0; i < params_.numberOfParallelDetectors_; i++) {
 
-            ind = j * params_.numberOfParallelDetectors_ + i + (k * parallelSize);
-            temp_1 = (s_[i] - L * sin(alphaCircle_[j] - kappa)) / params_.rDetector_;
+            const unsigned long long ind = j * params_.numberOfParallelDetectors_ + i + (k * parallelSize);
+            const float temp_1 = (s_[i] - L * sin(alphaCircle_[j] - kappa)) / params_.rDetector_;
 
             //Prüfen, ob asin möglich
             if (temp_1 <= 1 && temp_1 >= -1)
@@ -351,6 +305,60 @@ auto Fan2Para::computeFan2ParaTransp() -> void {
    }
 }
 
+auto Fan2Para::allocateFan2ParaTransp() -> void {
+   auto dataSetSize = params_.numberOfParallelProjections_ * params_.numberOfParallelDetectors_
+   * params_.numberOfPlanes_;
+
+   //allocate memory on host
+   theta_.assign(params_.numberOfFanProjections_, 0.0f);
+   gamma_.assign(params_.numberOfFanDetectors_, 0.0f);
+   s_.assign(params_.numberOfParallelDetectors_, 0.0f);
+   alphaCircle_.assign(params_.numberOfParallelProjections_, 0.0f);
+
+   thetaAfterRay1_.assign(dataSetSize, 0);
+   thetaAfterRay2_.assign(dataSetSize, 0);
+   thetaBeforeRay1_.assign(dataSetSize, 0);
+   thetaBeforeRay2_.assign(dataSetSize, 0);
+   gammaAfterRay1_.assign(dataSetSize, 0);
+   gammaAfterRay2_.assign(dataSetSize, 0);
+   gammaBeforeRay1_.assign(dataSetSize, 0);
+   gammaBeforeRay2_.assign(dataSetSize, 0);
+   gammaGoalRay1_.assign(dataSetSize, 0.0f);
+   gammaGoalRay2_.assign(dataSetSize, 0.0f);
+   thetaGoalRay1_.assign(dataSetSize, 0.0f);
+   thetaGoalRay2_.assign(dataSetSize, 0.0f);
+   ray1_.assign(dataSetSize, 0);
+   ray2_.assign(dataSetSize, 0);
+}
+
+auto Fan2Para::loadFan2ParaTransp(const TableCache& cache) -> bool {
+   allocateFan2ParaTransp();
+   //same order as in storeFan2ParaTransp
+   auto index = 0u;
+   return cache.copy(index++, theta_) && cache.copy(index++, gamma_)
+         && cache.copy(index++, s_) && cache.copy(index++, alphaCircle_)
+         && cache.copy(index++, thetaAfterRay1_) && cache.copy(index++, thetaAfterRay2_)
+         && cache.copy(index++, thetaBeforeRay1_) && cache.copy(index++, thetaBeforeRay2_)
+         && cache.copy(index++, gammaAfterRay1_) && cache.copy(index++, gammaAfterRay2_)
+         && cache.copy(index++, gammaBeforeRay1_) && cache.copy(index++, gammaBeforeRay2_)
+         && cache.copy(index++, gammaGoalRay1_) && cache.copy(index++, gammaGoalRay2_)
+         && cache.copy(index++, thetaGoalRay1_) && cache.copy(index++, thetaGoalRay2_)
+         && cache.copy(index++, ray1_) && cache.copy(index++, ray2_);
+}
+
+auto Fan2Para::storeFan2ParaTransp(TableCache& cache) -> void {
+   cache.add(theta_); cache.add(gamma_);
+   cache.add(s_); cache.add(alphaCircle_);
+   cache.add(thetaAfterRay1_); cache.add(thetaAfterRay2_);
+   cache.add(thetaBeforeRay1_); cache.add(thetaBeforeRay2_);
+   cache.add(gammaAfterRay1_); cache.add(gammaAfterRay2_);
+   cache.add(gammaBeforeRay1_); cache.add(gammaBeforeRay2_);
+   cache.add(gammaGoalRay1_); cache.add(gammaGoalRay2_);
+   cache.add(thetaGoalRay1_); cache.add(thetaGoalRay2_);
+   cache.add(ray1_); cache.add(ray2_);
+   cache.store();
+}
+
 auto Fan2Para::computeAngles(int i, int j, unsigned int ind, int k, float L,
       float kappa) -> void {
 
@@ -358,8 +366,7 @@ auto Fan2Para::computeAngles(int i, int j, unsigned int ind, int k, float L,
    float epsilon = 0;
 
    //Hilfsvariable
-   float dif_best = M_PI, dif = 0, best_x = 0, temp_1 = 0, temp_2 = 0;
-   int x = 0;
+   float temp_1 = 0, temp_2 = 0;
 
    //Berechnungsvorschrift
    //Theta
@@ -399,43 +406,17 @@ auto Fan2Para::computeAngles(int i, int j, unsigned int ind, int k, float L,
          gammaGoalRay1_[ind] = gammaGoalRay1_[ind] - 2.0 * M_PI;
 
       //Vektor Teta nach Wert durchsuchen für Fall 1
-      for (x = 0; x < params_.numberOfFanProjections_; x++) {
-         if (thetaGoalRay1_[ind] <= theta_[x]) {
-            dif = theta_[x] - thetaGoalRay1_[ind];
-            if (dif < dif_best) {
-               dif_best = dif;
-               best_x = x;
-            }
-         }
-      }
-
-      if (best_x == 0) {
-         thetaBeforeRay1_[ind] = params_.numberOfFanProjections_ - 1;
-         thetaAfterRay1_[ind] = best_x;
-      } else {
-         thetaBeforeRay1_[ind] = best_x - 1;
-         thetaAfterRay1_[ind] = best_x;
-      }
+      thetaAfterRay1_[ind] = findTheta(thetaGoalRay1_[ind]);
+      thetaBeforeRay1_[ind] = (thetaAfterRay1_[ind] + params_.numberOfFanProjections_ - 1)
+            % params_.numberOfFanProjections_;
 
       //Vektor Gamma nach Wert durchsuchen für Fall 1
-      for (x = 0; x < params_.numberOfFanDetectors_; x++) {
-         if (gammaGoalRay1_[ind] <= gamma_[x]) {
-            if (x == 0)
-               gammaBeforeRay1_[ind] = params_.numberOfFanDetectors_ - 1;
-            else
-               gammaBeforeRay1_[ind] = x - 1;
-            gammaAfterRay1_[ind] = x;
-            break;
-         }
-      }
-      if (gammaGoalRay1_[ind] > gamma_[params_.numberOfFanDetectors_ - 1]) {
-         gammaBeforeRay1_[ind] = params_.numberOfFanDetectors_ - 1;
-         gammaAfterRay1_[ind] = 0;
-      }
+      gammaAfterRay1_[ind] = findGamma(gammaGoalRay1_[ind]);
+      gammaBeforeRay1_[ind] = (gammaAfterRay1_[ind] + params_.numberOfFanDetectors_ - 1)
+            % params_.numberOfFanDetectors_;
    }
 
    if (ray2_[ind]) {
-      dif_best = M_PI;
 
       //Gamma für Fall 2
       gammaGoalRay2_[ind] = -epsilon + alphaCircle_[j] - (M_PI / 2.0);
@@ -443,155 +424,181 @@ auto Fan2Para::computeAngles(int i, int j, unsigned int ind, int k, float L,
          gammaGoalRay2_[ind] = gammaGoalRay2_[ind] + 2.0 * M_PI;
 
       //Vektor Teta nach Wert durchsuchen für Fall 2
-      for (x = 0; x < params_.numberOfFanProjections_; x++) {
-         if (thetaGoalRay2_[ind] <= theta_[x]) {
-            dif = theta_[x] - thetaGoalRay2_[ind];
-            if (dif < dif_best) {
-               dif_best = dif;
-               best_x = x;
-            }
-         }
-      }
-      if (best_x == 0) {
-         thetaBeforeRay2_[ind] = params_.numberOfFanProjections_ - 1;
-         thetaAfterRay2_[ind] = best_x;
-
-      } else {
-         thetaBeforeRay2_[ind] = best_x - 1;
-         thetaAfterRay2_[ind] = best_x;
-      }
+      thetaAfterRay2_[ind] = findTheta(thetaGoalRay2_[ind]);
+      thetaBeforeRay2_[ind] = (thetaAfterRay2_[ind] + params_.numberOfFanProjections_ - 1)
+            % params_.numberOfFanProjections_;
 
       //Vektor Gamma nach Wert durchsuchen für Fall 2
-      for (x = 0; x < params_.numberOfFanDetectors_; x++) {
-         if (gammaGoalRay2_[ind] <= gamma_[x]) {
-            if (x == 0)
-               gammaBeforeRay2_[ind] = params_.numberOfFanDetectors_ - 1;
-            else
-               gammaBeforeRay2_[ind] = x - 1;
-            gammaAfterRay2_[ind] = x;
-            break;
+      gammaAfterRay2_[ind] = findGamma(gammaGoalRay2_[ind]);
+      gammaBeforeRay2_[ind] = (gammaAfterRay2_[ind] + params_.numberOfFanDetectors_ - 1)
+            % params_.numberOfFanDetectors_;
+   }
+}
+
+auto Fan2Para::findTheta(float thetaGoal) const -> int {
+   //theta_ is sorted ascending, rotated by thetaMinIdx_ due to the source offset
+   const auto numberOfFanProjections = params_.numberOfFanProjections_;
+   auto lo = 0, hi = numberOfFanProjections;
+   while (lo < hi) {
+      const auto mid = (lo + hi) / 2;
+      if (theta_[(thetaMinIdx_ + mid) % numberOfFanProjections] < thetaGoal)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   //if thetaGoal is larger than all source positions, interpolate across 2 pi
+   return (thetaMinIdx_ + lo) % numberOfFanProjections;
+}
+
+auto Fan2Para::findGamma(float gammaGoal) const -> int {
+   const auto it = std::lower_bound(gamma_.cbegin(), gamma_.cend(), gammaGoal);
+   //if gammaGoal is larger than all detector positions, interpolate across 2 pi
+   if (it == gamma_.cend())
+      return 0;
+   return it - gamma_.cbegin();
+}
+
+auto Fan2Para::transferToDevice(unsigned int deviceID) -> void {
+   if (rebinningMethod_ == detail::RebinningMethod::hashTable)
+      CHECK(cudaMemcpyAsync(packedTable_d_[deviceID].get(), packedTable_.data(),
+            packedTable_.size(), cudaMemcpyHostToDevice, streams_[deviceID]));
+   if (rebinningMethod_ == detail::RebinningMethod::sparseMatrix) {
+      CHECK(cudaMemcpyAsync(csrRowPtr_d_[deviceID].get(), csrRowPtr_.data(),
+            sizeof(int) * csrRowPtr_.size(), cudaMemcpyHostToDevice, streams_[deviceID]));
+      CHECK(cudaMemcpyAsync(csrColInd_d_[deviceID].get(), csrColInd_.data(),
+            sizeof(int) * csrColInd_.size(), cudaMemcpyHostToDevice, streams_[deviceID]));
+      CHECK(cudaMemcpyAsync(csrValues_d_[deviceID].get(), csrValues_.data(),
+            sizeof(float) * csrValues_.size(), cudaMemcpyHostToDevice, streams_[deviceID]));
+   }
+}
+
+auto Fan2Para::computePackedTable() -> void {
+   //the indices are stored as 16 bit values
+   if (params_.numberOfFanProjections_ > std::numeric_limits<unsigned short>::max() + 1
+         || params_.numberOfFanDetectors_ > std::numeric_limits<unsigned short>::max() + 1)
+      throw std::runtime_error("recoLib::cuda::Fan2Para: Fan beam geometry too large for the packed hash table.");
+
+   const auto numberOfParallelDetectors = params_.numberOfParallelDetectors_;
+   const auto bins = numberOfParallelDetectors * params_.numberOfParallelProjections_;
+   const auto layout = packedLayout(bins);
+   packedPlaneSize_ = layout.size;
+   packedTable_.assign(params_.numberOfPlanes_ * layout.size, 0);
+
+   for (auto k = 0; k < params_.numberOfPlanes_; k++) {
+      auto table = packedTable_.data() + k * layout.size;
+      auto valid = reinterpret_cast<unsigned int*>(table + layout.valid);
+      auto theta = reinterpret_cast<unsigned short*>(table + layout.theta);
+      auto gamma = reinterpret_cast<unsigned short*>(table + layout.gamma);
+      auto weights = reinterpret_cast<float*>(table + layout.weights);
+
+      for (auto n = 0; n < bins; n++) {
+         const auto ind = n + k * bins;
+         const float temp_1 = s_[n % numberOfParallelDetectors] / params_.rDetector_;
+         if (temp_1 > 1 || temp_1 < -1 || ray1_[ind] + ray2_[ind] == 0)
+            continue;
+         //each ray is weighted equally, the factor 0.5 averages the two halves of the 360 degree sinogram
+         const float rayWeight = 0.5f / (float) (ray1_[ind] + ray2_[ind]);
+         const int ray[2] = { ray1_[ind], ray2_[ind] };
+         const int thetaBefore[2] = { thetaBeforeRay1_[ind], thetaBeforeRay2_[ind] };
+         const int thetaAfter[2] = { thetaAfterRay1_[ind], thetaAfterRay2_[ind] };
+         const int gammaBefore[2] = { gammaBeforeRay1_[ind], gammaBeforeRay2_[ind] };
+         const int gammaAfter[2] = { gammaAfterRay1_[ind], gammaAfterRay2_[ind] };
+         const float thetaGoal[2] = { thetaGoalRay1_[ind], thetaGoalRay2_[ind] };
+         const float gammaGoal[2] = { gammaGoalRay1_[ind], gammaGoalRay2_[ind] };
+         for (auto r = 0; r < 2; r++) {
+            if (!ray[r])
+               continue;
+            valid[r * layout.numberOfWords + n / 32] |= 1u << (n % 32);
+            theta[2 * r * bins + n] = thetaBefore[r];
+            theta[(2 * r + 1) * bins + n] = thetaAfter[r];
+            gamma[2 * r * bins + n] = gammaBefore[r];
+            gamma[(2 * r + 1) * bins + n] = gammaAfter[r];
+            //bilinear interpolation between the neighbouring source and detector positions
+            const float a = (thetaGoal[r] - theta_[thetaBefore[r]]) / (theta_[thetaAfter[r]] - theta_[thetaBefore[r]]);
+            const float b = (gammaGoal[r] - gamma_[gammaBefore[r]]) / (gamma_[gammaAfter[r]] - gamma_[gammaBefore[r]]);
+            weights[4 * r * bins + n] = rayWeight * (1.0f - a) * (1.0f - b);
+            weights[(4 * r + 1) * bins + n] = rayWeight * (1.0f - a) * b;
+            weights[(4 * r + 2) * bins + n] = rayWeight * a * (1.0f - b);
+            weights[(4 * r + 3) * bins + n] = rayWeight * a * b;
          }
       }
-      if (gammaGoalRay2_[ind] > gamma_[params_.numberOfFanDetectors_ - 1]) {
-         gammaBeforeRay2_[ind] = params_.numberOfFanDetectors_ - 1;
-         gammaAfterRay2_[ind] = 0;
-      }
    }
+   BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::Fan2Para: Packed hash table has " << packedPlaneSize_ / 1024 << " KiB per plane.";
 }
 
-auto Fan2Para::transferToDevice(unsigned int deviceID) -> void {
-   CHECK(
-         cudaMemcpyAsync(thrust::raw_pointer_cast(&(theta_d_[deviceID][0])),
-               thrust::raw_pointer_cast(&theta_[0]),
-               sizeof(float) * theta_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(thrust::raw_pointer_cast(&gamma_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&gamma_[0]),
-               sizeof(float) * gamma_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(thrust::raw_pointer_cast(&s_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&s_[0]), sizeof(float) * s_.size(),
-               cudaMemcpyHostToDevice, streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(thrust::raw_pointer_cast(&alphaCircle_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&alphaCircle_[0]),
-               sizeof(float) * alphaCircle_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&thetaAfterRay1_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&thetaAfterRay1_[0]),
-               sizeof(int) * thetaAfterRay1_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&thetaAfterRay2_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&thetaAfterRay2_[0]),
-               sizeof(int) * thetaAfterRay2_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&thetaBeforeRay1_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&thetaBeforeRay1_[0]),
-               sizeof(int) * thetaBeforeRay1_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&thetaBeforeRay2_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&thetaBeforeRay2_[0]),
-               sizeof(int) * thetaBeforeRay2_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&gammaAfterRay1_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&gammaAfterRay1_[0]),
-               sizeof(int) * gammaAfterRay1_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&gammaAfterRay2_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&gammaAfterRay2_[0]),
-               sizeof(int) * gammaAfterRay2_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&gammaBeforeRay1_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&gammaBeforeRay1_[0]),
-               sizeof(int) * gammaBeforeRay1_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&gammaBeforeRay2_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&gammaBeforeRay2_[0]),
-               sizeof(int) * gammaBeforeRay2_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&gammaGoalRay1_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&gammaGoalRay1_[0]),
-               sizeof(float) * gammaGoalRay1_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&gammaGoalRay2_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&gammaGoalRay2_[0]),
-               sizeof(float) * gammaGoalRay2_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&thetaGoalRay1_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&thetaGoalRay1_[0]),
-               sizeof(float) * thetaGoalRay1_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(
-               thrust::raw_pointer_cast(&thetaGoalRay2_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&thetaGoalRay2_[0]),
-               sizeof(float) * thetaGoalRay2_.size(), cudaMemcpyHostToDevice,
-               streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(thrust::raw_pointer_cast(&ray1_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&ray1_[0]), ray1_.size() * sizeof(int),
-               cudaMemcpyHostToDevice, streams_[deviceID]));
-   CHECK(
-         cudaMemcpyAsync(thrust::raw_pointer_cast(&ray2_d_[deviceID][0]),
-               thrust::raw_pointer_cast(&ray2_[0]), ray2_.size() * sizeof(int),
-               cudaMemcpyHostToDevice, streams_[deviceID]));
+auto Fan2Para::computeSparseMatrix() -> void {
+   const auto numberOfFanDetectors = params_.numberOfFanDetectors_;
+   const auto numberOfParallelDetectors = params_.numberOfParallelDetectors_;
+   const auto numberOfParallelProjections = params_.numberOfParallelProjections_;
+   const auto bins = numberOfParallelDetectors * numberOfParallelProjections;
+   const auto numberOfRows = bins / 2;
+   const auto layout = packedLayout(bins);
+
+   csrRowPtr_.assign(params_.numberOfPlanes_ * numberOfRows + 1, 0);
+   csrColInd_.clear();
+   csrValues_.clear();
+   std::vector<std::pair<int, float>> row;
+
+   for (auto k = 0; k < params_.numberOfPlanes_; k++) {
+      const auto table = packedTable_.data() + k * layout.size;
+      const auto valid = reinterpret_cast<const unsigned int*>(table + layout.valid);
+      const auto theta = reinterpret_cast<const unsigned short*>(table + layout.theta);
+      const auto gamma = reinterpret_cast<const unsigned short*>(table + layout.gamma);
+      const auto weights = reinterpret_cast<const float*>(table + layout.weights);
+
+      //adds the nonzeros of one bin of the 360 degree parallel beam sinogram
+      auto addBin = [&](int n) {
+         for (auto r = 0; r < 2; r++) {
+            if (!((valid[r * layout.numberOfWords + n / 32] >> (n % 32)) & 1u))
+               continue;
+            const int thetaBefore = theta[2 * r * bins + n] * numberOfFanDetectors;
+            const int thetaAfter = theta[(2 * r + 1) * bins + n] * numberOfFanDetectors;
+            const int gammaBefore = gamma[2 * r * bins + n];
+            const int gammaAfter = gamma[(2 * r + 1) * bins + n];
+            row.emplace_back(thetaBefore + gammaBefore, weights[4 * r * bins + n]);
+            row.emplace_back(thetaBefore + gammaAfter, weights[(4 * r + 1) * bins + n]);
+            row.emplace_back(thetaAfter + gammaBefore, weights[(4 * r + 2) * bins + n]);
+            row.emplace_back(thetaAfter + gammaAfter, weights[(4 * r + 3) * bins + n]);
+         }
+      };
+
+      for (auto j = 0; j < numberOfParallelProjections / 2; j++) {
+         for (auto i = 0; i < numberOfParallelDetectors; i++) {
+            //conversion from 360 to 180 degrees, the second half is mirrored
+            row.clear();
+            addBin(j * numberOfParallelDetectors + i);
+            addBin((j + numberOfParallelProjections / 2) * numberOfParallelDetectors
+                  + numberOfParallelDetectors - 1 - i);
+            std::sort(row.begin(), row.end(),
+                  [](const std::pair<int, float>& lhs, const std::pair<int, float>& rhs) { return lhs.first < rhs.first; });
+            for (auto n = 0u; n < row.size(); n++) {
+               if (n > 0 && row[n].first == row[n - 1].first)
+                  csrValues_.back() += row[n].second;
+               else {
+                  csrColInd_.push_back(row[n].first);
+                  csrValues_.push_back(row[n].second);
+               }
+            }
+            csrRowPtr_[k * numberOfRows + j * numberOfParallelDetectors + i + 1] = csrColInd_.size();
+         }
+      }
+   }
+   BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::Fan2Para: Rebinning matrix has " << csrValues_.size() << " nonzeros ("
+         << csrValues_.size() / (float) (params_.numberOfPlanes_ * numberOfRows) << " per bin).";
 }
 
-/**
- * All values needed for setting up the class are read from the config file
- * in this function.
- *
- * @param[in] configFile path to config file
- *
- * @return returns true, if configuration file could be read successfully, else false
- */
 auto Fan2Para::readConfig(const std::string& configFile) -> bool {
    int scanRate, samplingRate;
    ConfigReader configReader = ConfigReader(configFile.data());
+   //optional parameter, the hash table is used if not specified
+   std::string rebinningMethod = "hashTable";
+   configReader.lookupValue("rebinningMethod", rebinningMethod);
+   if (rebinningMethod == "sparseMatrix")
+      rebinningMethod_ = detail::RebinningMethod::sparseMatrix;
+   else if (rebinningMethod != "hashTable")
+      BOOST_LOG_TRIVIAL(warning) << "recoLib::cuda::Fan2Para: Requested rebinning method not supported. Using hash table.";
+   //optional parameter, the lookup tables are recomputed at every start if not specified
+   configReader.lookupValue("tableCacheDirectory", tableCacheDirectory_);
    if (configReader.lookupValue("numberOfParallelProjections", params_.numberOfParallelProjections_)
          && configReader.lookupValue("numberOfParallelDetectors", params_.numberOfParallelDetectors_)
          && configReader.lookupValue("numberOfFanDetectors", params_.numberOfFanDetectors_)
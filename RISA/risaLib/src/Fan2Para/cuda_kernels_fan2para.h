@@ -25,11 +25,13 @@
 #define CUDA_KERNELS_FAN2PARA_H_
 
 #include <risa/Fan2Para/Fan2Para.h>
+#include <risa/Basics/geometry.h>
 
 #include <glados/cuda/Coordinates.h>
 
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <cstddef>
 #include <stdio.h>
 
 namespace risa {
@@ -61,127 +63,134 @@ auto ellipse_kreis_uwe(T alpha, T DX, T DZ, T SourceRingDiam) -> T {
       return 2.0 * M_PI - acos(ae);
 }
 
-__global__ void interpolation(int k, const float* __restrict__ SinFan_data,
-      float* __restrict__ SinPar_data, const float* __restrict__ Gamma,
-      const float* __restrict__ Teta, const float* __restrict__ alpha_kreis,
-      const float* __restrict__ s, const int* __restrict__ teta_nach_ray_1,
-      const int* __restrict__ teta_nach_ray_2,
-      const int* __restrict__ teta_vor_ray_1,
-      const int* __restrict__ teta_vor_ray_2,
-      const int* __restrict__ gamma_vor_ray_1,
-      const int* __restrict__ gamma_vor_ray_2,
-      const int* __restrict__ gamma_nach_ray_1,
-      const int* __restrict__ gamma_nach_ray_2,
-      const float* __restrict__ teta_ziel_ray_1,
-      const float* __restrict__ teta_ziel_ray_2,
-      const float* __restrict__ gamma_ziel_ray_1,
-      const float* __restrict__ gamma_ziel_ray_2, const int* __restrict__ ray_1,
-      const int* __restrict__ ray_2, const parameters* __restrict__ params) {
-
-   int i = glados::cuda::getX();
-   int j = glados::cuda::getY();
-   //finish all threads, that operate outside the bounds of the data field
-   if (i >= (*params).numberOfParallelDetectors_
-         && j >= (*params).numberOfParallelProjections_)
+//! Applies the fan to parallel beam rebinning as sparse matrix vector product
+/**
+ * One thread computes one bin of the 180 degree parallel beam sinogram. As every bin is written
+ * exactly once, neither atomic operations nor zeroing of the output are necessary.
+ *
+ * @param[in]  fanSinogram       the fan beam sinogram
+ * @param[out] parallelSinogram  the parallel beam sinogram over 180 degrees
+ * @param[in]  rowPtr            CSR row pointers of the plane's rebinning matrix
+ * @param[in]  colInd            CSR column indices
+ * @param[in]  values            CSR values
+ * @param[in]  numberOfRows      the number of bins in the parallel beam sinogram
+ */
+template <typename T>
+__global__ void rebinSparse(const T* __restrict__ fanSinogram,
+      float* __restrict__ parallelSinogram, const int* __restrict__ rowPtr,
+      const int* __restrict__ colInd, const float* __restrict__ values,
+      const int numberOfRows) {
+   const auto row = glados::cuda::getX();
+   if (row >= numberOfRows)
       return;
 
-   //Übergabe-Paramter
-   float WZiel_1 = 0, WZiel_2 = 0, WZiel_end = 0, V1 = 0, V2 = 0, W1 = 0,
-         W2 = 0, W3 = 0, W4 = 0;
-
-   //k defines, which plane to use
-   unsigned long long ind = j * (*params).numberOfParallelDetectors_ + i
-         + (k * (*params).numberOfParallelProjections_
-               * (*params).numberOfParallelDetectors_);
-
-   float temp_1 = s[i] / (*params).rDetector_;
-
-   if (temp_1 <= 1 && temp_1 >= -1) {
-
-      if (ray_1[ind] == true) {
-         //Interpolationspunkte nehmen für Fall 1
-         W1 = SinFan_data[teta_vor_ray_1[ind] * (*params).numberOfFanDetectors_
-               + gamma_vor_ray_1[ind]];
-         W2 = SinFan_data[teta_vor_ray_1[ind] * (*params).numberOfFanDetectors_
-               + gamma_nach_ray_1[ind]];
-         W3 = SinFan_data[teta_nach_ray_1[ind] * (*params).numberOfFanDetectors_
-               + gamma_vor_ray_1[ind]];
-         W4 = SinFan_data[teta_nach_ray_1[ind] * (*params).numberOfFanDetectors_
-               + gamma_nach_ray_1[ind]];
-
-         //Interpolation durchführen für Fall 1
-         V1 = W1
-               + ((teta_ziel_ray_1[ind] - Teta[teta_vor_ray_1[ind]])
-                     / (Teta[teta_nach_ray_1[ind]] - Teta[teta_vor_ray_1[ind]]))
-                     * (W3 - W1);
-         V2 = W2
-               + ((teta_ziel_ray_1[ind] - Teta[teta_vor_ray_1[ind]])
-                     / (Teta[teta_nach_ray_1[ind]] - Teta[teta_vor_ray_1[ind]]))
-                     * (W4 - W2);
-         WZiel_1 = V1
-               + ((gamma_ziel_ray_1[ind] - Gamma[gamma_vor_ray_1[ind]])
-                     / (Gamma[gamma_nach_ray_1[ind]]
-                           - Gamma[gamma_vor_ray_1[ind]])) * (V2 - V1);
-      }
-      if (ray_2[ind] == true) {
-
-         //Interpolationspunkte nehmen für Fall 2
-         W1 = SinFan_data[teta_vor_ray_2[ind] * (*params).numberOfFanDetectors_
-               + gamma_vor_ray_2[ind]];
-         W2 = SinFan_data[teta_vor_ray_2[ind] * (*params).numberOfFanDetectors_
-               + gamma_nach_ray_2[ind]];
-         W3 = SinFan_data[teta_nach_ray_2[ind] * (*params).numberOfFanDetectors_
-               + gamma_vor_ray_2[ind]];
-         W4 = SinFan_data[teta_nach_ray_2[ind] * (*params).numberOfFanDetectors_
-               + gamma_nach_ray_2[ind]];
-
-         //Interpolation durchführen für Fall 2
-         V1 = W1
-               + ((teta_ziel_ray_2[ind] - Teta[teta_vor_ray_2[ind]])
-                     / (Teta[teta_nach_ray_2[ind]] - Teta[teta_vor_ray_2[ind]]))
-                     * (W3 - W1);
-         V2 = W2
-               + ((teta_ziel_ray_2[ind] - Teta[teta_vor_ray_2[ind]])
-                     / (Teta[teta_nach_ray_2[ind]] - Teta[teta_vor_ray_2[ind]]))
-                     * (W4 - W2);
-         WZiel_2 = V1
-               + ((gamma_ziel_ray_2[ind] - Gamma[gamma_vor_ray_2[ind]])
-                     / (Gamma[gamma_nach_ray_2[ind]]
-                           - Gamma[gamma_vor_ray_2[ind]])) * (V2 - V1);
-      }
-
-      if (ray_1[ind] + ray_2[ind] > 0)
-
-         WZiel_end = (float) ray_1[ind]
-               / ((float) ray_1[ind] + (float) ray_2[ind]) * WZiel_1
-               + (float) ray_2[ind] / ((float) ray_1[ind] + (float) ray_2[ind])
-                     * WZiel_2;
+   float sum = 0.0f;
+   for (auto n = rowPtr[row]; n < rowPtr[row + 1]; n++)
+      sum += values[n] * toFloat(fanSinogram[colInd[n]]);
+   parallelSinogram[row] = sum;
+}
+
+//! Byte offsets of the arrays in the packed lookup table of one plane
+/**
+ * The packed table stores all values needed for the rebinning of one plane as struct of arrays
+ * in one contiguous allocation. Each array starts at a 128 byte boundary. For ray r of bin n
+ * of the 360 degree parallel beam sinogram:
+ *  - bit n % 32 of valid[r * numberOfWords + n / 32] is set, if the ray contributes to the bin
+ *  - theta[2 * r * bins + n] and theta[(2 * r + 1) * bins + n] are the source positions before and after the ray
+ *  - gamma[2 * r * bins + n] and gamma[(2 * r + 1) * bins + n] are the detector positions before and after the ray
+ *  - weights[(4 * r + c) * bins + n] are the bilinear weights for (before, before), (before, after),
+ *    (after, before) and (after, after), including the weighting of the two rays and the
+ *    averaging of the conversion from 360 to 180 degrees
+ */
+struct packedTableLayout {
+   unsigned int numberOfWords;   //!< the number of 32 bit words of the validity mask of one ray
+   std::size_t valid;            //!< offset of the validity masks
+   std::size_t theta;            //!< offset of the source position indices
+   std::size_t gamma;            //!< offset of the detector position indices
+   std::size_t weights;          //!< offset of the bilinear weights
+   std::size_t size;             //!< the size of the packed table of one plane in bytes
+};
+
+__host__ __device__ __forceinline__ auto alignPackedTable(std::size_t offset) -> std::size_t {
+   return (offset + 127) / 128 * 128;
+}
+
+//! Computes the layout of the packed lookup table of one plane
+/**
+ * @param[in]  bins  the number of bins in the 360 degree parallel beam sinogram
+ */
+__host__ __device__ __forceinline__ auto packedLayout(int bins) -> packedTableLayout {
+   packedTableLayout layout;
+   layout.numberOfWords = (bins + 31) / 32;
+   layout.valid = 0;
+   layout.theta = alignPackedTable(layout.valid + 2 * layout.numberOfWords * sizeof(unsigned int));
+   layout.gamma = alignPackedTable(layout.theta + 4 * (std::size_t) bins * sizeof(unsigned short));
+   layout.weights = alignPackedTable(layout.gamma + 4 * (std::size_t) bins * sizeof(unsigned short));
+   layout.size = alignPackedTable(layout.weights + 8 * (std::size_t) bins * sizeof(float));
+   return layout;
+}
+
+//! Interpolates one bin of the 360 degree parallel beam sinogram from the packed lookup table
+template <typename T>
+__device__ __forceinline__ auto interpolateBin(const char* __restrict__ table, const packedTableLayout& layout,
+      const T* __restrict__ fanSinogram, const int bin, const int bins, const int numberOfFanDetectors) -> float {
+   const auto valid = reinterpret_cast<const unsigned int*>(table + layout.valid);
+   const auto theta = reinterpret_cast<const unsigned short*>(table + layout.theta);
+   const auto gamma = reinterpret_cast<const unsigned short*>(table + layout.gamma);
+   const auto weights = reinterpret_cast<const float*>(table + layout.weights);
+
+   float value = 0.0f;
+#pragma unroll
+   for (auto ray = 0; ray < 2; ray++) {
+      if (!((__ldg(&valid[ray * layout.numberOfWords + bin / 32]) >> (bin % 32)) & 1u))
+         continue;
+      const int thetaBefore = __ldg(&theta[2 * ray * bins + bin]) * numberOfFanDetectors;
+      const int thetaAfter = __ldg(&theta[(2 * ray + 1) * bins + bin]) * numberOfFanDetectors;
+      const int gammaBefore = __ldg(&gamma[2 * ray * bins + bin]);
+      const int gammaAfter = __ldg(&gamma[(2 * ray + 1) * bins + bin]);
+      value += __ldg(&weights[4 * ray * bins + bin]) * toFloat(fanSinogram[thetaBefore + gammaBefore])
+            + __ldg(&weights[(4 * ray + 1) * bins + bin]) * toFloat(fanSinogram[thetaBefore + gammaAfter])
+            + __ldg(&weights[(4 * ray + 2) * bins + bin]) * toFloat(fanSinogram[thetaAfter + gammaBefore])
+            + __ldg(&weights[(4 * ray + 3) * bins + bin]) * toFloat(fanSinogram[thetaAfter + gammaAfter]);
    }
-   //conversion from 360 to 180 degrees
-   const int address = j * (*params).numberOfParallelDetectors_;
-   const int parallelSize = (*params).numberOfParallelProjections_
-         * (*params).numberOfParallelDetectors_;
-   const int detectorSize_2 = (*params).numberOfParallelDetectors_ / 2;
-   int mirrorOffset = 0;
-   if (i < detectorSize_2)
-      mirrorOffset = (*params).numberOfParallelDetectors_ - i - 1;
-   else
-      mirrorOffset = -(i % detectorSize_2) + detectorSize_2 - 1;
-   if (j < ((*params).numberOfParallelProjections_ / 2))
-      //first half of the parallel sinogram
-      atomicAdd(&SinPar_data[address + i], WZiel_end*0.5);
-   else
-      //second half of the parallel sinogram
-      atomicAdd(&SinPar_data[address - parallelSize / 2 + mirrorOffset],
-            WZiel_end * 0.5);
+   return value;
 }
 
-template<typename T>
-__global__ void setValue(T* data, T value, int size) {
-   auto id = glados::cuda::getX();
-   if (id >= size)
+//! Applies the fan to parallel beam rebinning using the packed lookup table
+/**
+ * One thread computes one bin of the 180 degree parallel beam sinogram, i.e. the sum of the bin
+ * of the first half of the 360 degree sinogram and the mirrored bin of the second half. Every
+ * bin is written exactly once, atomic operations and zeroing of the output are not necessary.
+ *
+ * @param[in]  table             the packed lookup table of the plane
+ * @param[in]  fanSinogram       the fan beam sinogram
+ * @param[out] parallelSinogram  the parallel beam sinogram over 180 degrees
+ */
+template <int NumberOfFanDetectors, int NumberOfParallelDetectors, int NumberOfParallelProjections, typename T>
+__global__ void interpolation(const char* __restrict__ table, const T* __restrict__ fanSinogram,
+      float* __restrict__ parallelSinogram, const int numberOfFanDetectorsRuntime,
+      const int numberOfParallelDetectorsRuntime, const int numberOfParallelProjectionsRuntime) {
+
+   //dimensions are taken from the template parameters, if specified
+   const int numberOfFanDetectors = geometry::select<NumberOfFanDetectors>(numberOfFanDetectorsRuntime);
+   const int numberOfParallelDetectors = geometry::select<NumberOfParallelDetectors>(numberOfParallelDetectorsRuntime);
+   const int numberOfParallelProjections = geometry::select<NumberOfParallelProjections>(numberOfParallelProjectionsRuntime);
+
+   const int i = glados::cuda::getX();
+   const int j = glados::cuda::getY();
+   //finish all threads, that operate outside the bounds of the data field
+   if (i >= numberOfParallelDetectors || j >= numberOfParallelProjections / 2)
       return;
-   data[id] = value;
+
+   const int bins = numberOfParallelDetectors * numberOfParallelProjections;
+   const auto layout = packedLayout(bins);
+
+   //conversion from 360 to 180 degrees, the second half is mirrored
+   const int first = j * numberOfParallelDetectors + i;
+   const int second = (j + numberOfParallelProjections / 2) * numberOfParallelDetectors
+         + numberOfParallelDetectors - 1 - i;
+   parallelSinogram[first] = interpolateBin(table, layout, fanSinogram, first, bins, numberOfFanDetectors)
+         + interpolateBin(table, layout, fanSinogram, second, bins, numberOfFanDetectors);
 }
 
 }
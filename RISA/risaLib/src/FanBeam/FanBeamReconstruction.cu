@@ -0,0 +1,405 @@
+/*
+ * This file is part of the RISA-library.
+ *
+ * Copyright (C) 2026 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * RISA is free software: You can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * RISA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with RISA. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 18 October 2026
+ * Authors: agent <agent@local>
+ *
+ */
+
+#include <risa/FanBeam/FanBeamReconstruction.h>
+#include <risa/ConfigReader/ConfigReader.h>
+#include "../Fan2Para/cuda_kernels_fan2para.h"
+
+#include <glados/MemoryPool.h>
+#include <glados/cuda/Check.h>
+#include <glados/cuda/Coordinates.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <cmath>
+#include <exception>
+#include <numeric>
+
+namespace risa {
+namespace cuda {
+
+FanBeamReconstruction::FanBeamReconstruction(const std::string& configFile) {
+
+   if (readConfig(configFile)) {
+      throw std::runtime_error(
+            "recoLib::cuda::FanBeamReconstruction: Configuration file could not be loaded successfully. Please check!");
+   }
+
+   CHECK(cudaGetDeviceCount(&numberOfDevices_));
+
+   computeGeometry();
+
+   //allocate memory in memory pool for each device
+   for (auto i = 0; i < numberOfDevices_; i++) {
+      CHECK(cudaSetDevice(i));
+      memoryPoolIdxs_.push_back(
+         glados::MemoryPool<deviceManagerType>::instance()->registerStage(
+               memPoolSize_, numberOfPixels_ * numberOfPixels_));
+      //custom streams are necessary, because profiling with nvprof seems to be
+      //not possible with -default-stream per-thread option
+      cudaStream_t stream;
+      CHECK(cudaStreamCreateWithPriority(&stream, cudaStreamNonBlocking, 2));
+      streams_[i] = stream;
+   }
+
+   //initialize worker threads
+   for (auto i = 0; i < numberOfDevices_; i++) {
+      processorThreads_[i] =
+         std::thread { &FanBeamReconstruction::processor, this, i };
+   }
+   BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::FanBeamReconstruction: Running " << numberOfDevices_ << " Threads.";
+}
+
+FanBeamReconstruction::~FanBeamReconstruction() {
+   for (auto idx : memoryPoolIdxs_) {
+      glados::MemoryPool<deviceManagerType>::instance()->freeMemory(idx);
+   }
+   for (auto& ele : streams_) {
+      CHECK(cudaSetDevice(ele.first));
+      CHECK(cudaStreamDestroy(ele.second));
+   }
+   BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::FanBeamReconstruction: Destroyed.";
+}
+
+auto FanBeamReconstruction::process(input_type&& sinogram) -> void {
+   if (sinogram.valid()) {
+      BOOST_LOG_TRIVIAL(debug)<< "FanBeamReconstruction: Image arrived with Index: " << sinogram.index() << "to device " << sinogram.device();
+      sinograms_[sinogram.device()].push(std::move(sinogram));
+   } else {
+      BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::FanBeamReconstruction: Received sentinel, finishing.";
+
+      //send sentinal to processor thread and wait 'til it's finished
+      for(auto i = 0; i < numberOfDevices_; i++) {
+         sinograms_[i].push(input_type());
+      }
+      for(auto i = 0; i < numberOfDevices_; i++) {
+         processorThreads_[i].join();
+      }
+
+      results_.push(output_type());
+      BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::FanBeamReconstruction: Finished.";
+   }
+}
+
+auto FanBeamReconstruction::wait() -> output_type {
+   return results_.take();
+}
+
+auto FanBeamReconstruction::processor(const int deviceID) -> void {
+   CHECK(cudaSetDevice(deviceID));
+
+   const auto sinogramSize = numberOfFanDetectors_ * numberOfFanProjections_;
+
+   //transfer geometry tables of all planes to device
+   auto fanAngles_d = glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(fanAngles_.size());
+   auto weights_d = glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(weights_.size());
+   auto sources_d = glados::cuda::make_device_ptr<float2, glados::cuda::async_copy_policy>(sources_.size());
+   auto sourceIncrements_d = glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(sourceIncrements_.size());
+   CHECK(cudaMemcpyAsync(fanAngles_d.get(), fanAngles_.data(), sizeof(float) * fanAngles_.size(),
+         cudaMemcpyHostToDevice, streams_[deviceID]));
+   CHECK(cudaMemcpyAsync(weights_d.get(), weights_.data(), sizeof(float) * weights_.size(),
+         cudaMemcpyHostToDevice, streams_[deviceID]));
+   CHECK(cudaMemcpyAsync(sources_d.get(), sources_.data(), sizeof(float2) * sources_.size(),
+         cudaMemcpyHostToDevice, streams_[deviceID]));
+   CHECK(cudaMemcpyAsync(sourceIncrements_d.get(), sourceIncrements_.data(), sizeof(float) * sourceIncrements_.size(),
+         cudaMemcpyHostToDevice, streams_[deviceID]));
+
+   //the filtered fan beam sinogram is only needed within one iteration
+   auto filtered = glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(sinogramSize);
+
+   //units of the parallel beam reconstruction: one parallel detector spacing
+   const float outputScale = imageWidth_ / (float) numberOfParallelDetectors_;
+   const float pixelSize = imageWidth_ / (float) numberOfPixels_;
+   const float cosRotation = std::cos(rotationOffset_ / 180.0 * M_PI);
+   const float sinRotation = std::sin(rotationOffset_ / 180.0 * M_PI);
+
+   const int blockSizeFilter = 256;
+   const auto sharedMemoryFilter = 2 * numberOfFanDetectors_ * sizeof(float);
+   dim3 blocks(blockSize2D_, blockSize2D_);
+   dim3 grids(std::ceil(numberOfPixels_ / (float) blockSize2D_),
+         std::ceil(numberOfPixels_ / (float) blockSize2D_));
+   CHECK(cudaStreamSynchronize(streams_[deviceID]));
+   BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::FanBeamReconstruction: Running Thread for Device " << deviceID;
+   while (true) {
+      auto sinogram = sinograms_[deviceID].take();
+      if (!sinogram.valid())
+         break;
+
+      BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::FanBeamReconstruction: Reconstructing sinogram with Index " << sinogram.index();
+
+      auto recoImage =
+            glados::MemoryPool<deviceManagerType>::instance()->requestMemory(
+                  memoryPoolIdxs_[deviceID]);
+
+      const auto plane = sinogram.plane();
+      filterFanBeam<<<numberOfFanProjections_, blockSizeFilter, sharedMemoryFilter, streams_[deviceID]>>>(
+            sinogram.container().get(), filtered.get(), fanAngles_d.get() + plane * sinogramSize,
+            weights_d.get() + plane * sinogramSize, numberOfFanDetectors_, delta_[plane]);
+      CHECK(cudaPeekAtLastError());
+
+      backProjectFanBeam<<<grids, blocks, 0, streams_[deviceID]>>>(
+            filtered.get(), recoImage.container().get(),
+            sources_d.get() + plane * numberOfFanProjections_,
+            sourceIncrements_d.get() + plane * numberOfFanProjections_,
+            numberOfPixels_, numberOfFanProjections_, numberOfFanDetectors_,
+            rDetector_, pixelSize, imageCenterX_, imageCenterY_,
+            cosRotation, sinRotation, outputScale);
+      CHECK(cudaPeekAtLastError());
+
+      recoImage.setIdx(sinogram.index());
+      recoImage.setDevice(deviceID);
+      recoImage.setPlane(sinogram.plane());
+      recoImage.setStart(sinogram.start());
+
+      //wait until work on device is finished
+      CHECK(cudaStreamSynchronize(streams_[deviceID]));
+      results_.push(std::move(recoImage));
+
+      BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::FanBeamReconstruction: Reconstructing sinogram with Index " << sinogram.index() << " finished.";
+   }
+}
+
+auto FanBeamReconstruction::computeGeometry() -> void {
+   BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::FanBeamReconstruction: Computing fan beam geometry.";
+
+   const auto sinogramSize = numberOfFanDetectors_ * numberOfFanProjections_;
+   fanAngles_.assign(sinogramSize * numberOfPlanes_, 0.0);
+   weights_.assign(sinogramSize * numberOfPlanes_, 0.0);
+   sources_.resize(numberOfFanProjections_ * numberOfPlanes_);
+   sourceIncrements_.assign(numberOfFanProjections_ * numberOfPlanes_, 0.0);
+
+   const double twoPi = 2.0 * M_PI;
+   auto wrap = [twoPi](double angle) -> double {
+      angle = std::fmod(angle, twoPi);
+      return angle < 0.0 ? angle + twoPi : angle;
+   };
+
+   for (auto k = 0; k < numberOfPlanes_; k++) {
+      //the target ring is tilted against the detector plane, ellipse_kreis_uwe maps the angle
+      //on the projected circle onto the angle of the source position
+      auto ellipse = [&](double alpha) -> double {
+         return ellipse_kreis_uwe<double>(alpha, deltaX_[k], deltaZ_[k], 2.0 * rTarget_[k]);
+      };
+      //the mapping is monotonic, so it is inverted by bisection
+      auto circleAngle = [&](double theta) -> double {
+         double lower = 0.0, upper = twoPi;
+         for (auto it = 0; it < 50; it++) {
+            const double mid = 0.5 * (lower + upper);
+            if (ellipse(mid) < theta)
+               lower = mid;
+            else
+               upper = mid;
+         }
+         return 0.5 * (lower + upper);
+      };
+      //same covered source range as in Fan2Para
+      const double lowerLimit = ((360.0 - sourceAngle_[k]) / 2.0) / 180.0 * M_PI;
+      const double upperLimit = (360.0 - ((360.0 - sourceAngle_[k]) / 2.0)) / 180.0 * M_PI;
+      auto covered = [&](double theta) -> bool {
+         return theta > lowerLimit && theta < upperLimit;
+      };
+
+      std::vector<double> phi(numberOfFanProjections_);
+      std::vector<bool> validProjection(numberOfFanProjections_);
+      for (auto j = 0; j < numberOfFanProjections_; j++) {
+         const double theta = wrap((j * (360.0 / numberOfFanProjections_) - sourceOffset_) / 180.0 * M_PI);
+         validProjection[j] = covered(theta);
+         phi[j] = circleAngle(theta);
+         sources_[k * numberOfFanProjections_ + j] =
+               make_float2(rTarget_[k] * std::cos(phi[j]), rTarget_[k] * std::sin(phi[j]));
+      }
+
+      double deltaSum = 0.0;
+      int deltaCount = 0;
+      for (auto j = 0; j < numberOfFanProjections_; j++) {
+         if (!validProjection[j])
+            continue;
+         const auto next = phi[(j + 1) % numberOfFanProjections_];
+         const auto prev = phi[(j - 1 + numberOfFanProjections_) % numberOfFanProjections_];
+         sourceIncrements_[k * numberOfFanProjections_ + j] = 0.5 * wrap(next - prev);
+
+         const double sx = rTarget_[k] * std::cos(phi[j]), sy = rTarget_[k] * std::sin(phi[j]);
+         std::vector<double> psi(numberOfFanDetectors_);
+         std::vector<double> redundancy(numberOfFanDetectors_, 0.0);
+         for (auto i = 0; i < numberOfFanDetectors_; i++) {
+            //geometric detector angle, gamma = 0 is located at 90 degrees
+            const double gamma = i * twoPi / numberOfFanDetectors_ + 0.5 * M_PI;
+            const double dx = rDetector_ * std::cos(gamma) - sx, dy = rDetector_ * std::sin(gamma) - sy;
+            //signed angle between the central ray (towards the origin) and the ray to the detector
+            psi[i] = std::atan2(-sx * dy + sy * dx, -sx * dx - sy * dy);
+            //only detectors on the far side of the ring are hit by the ray
+            if (dx * std::cos(gamma) + dy * std::sin(gamma) <= 0.0)
+               continue;
+            //the conjugate ray starts at the second intersection of the line with the source circle
+            const double norm = std::sqrt(dx * dx + dy * dy);
+            const double mu = -2.0 * (sx * dx + sy * dy) / norm;
+            const double conjugate = wrap(std::atan2(sy + mu * dy / norm, sx + mu * dx / norm));
+            redundancy[i] = covered(ellipse(conjugate)) ? 1.0 : 2.0;
+         }
+         for (auto i = 0; i < numberOfFanDetectors_; i++) {
+            const auto ind = k * sinogramSize + j * numberOfFanDetectors_ + i;
+            fanAngles_[ind] = psi[i];
+            if (redundancy[i] == 0.0)
+               continue;
+            //quadrature weight of the non-equidistant fan angles
+            const double dPsi = 0.5 * (std::abs(psi[(i + 1) % numberOfFanDetectors_] - psi[i])
+                  + std::abs(psi[i] - psi[(i - 1 + numberOfFanDetectors_) % numberOfFanDetectors_]));
+            weights_[ind] = redundancy[i] * rTarget_[k] * std::cos(psi[i]) * dPsi;
+            deltaSum += dPsi;
+            deltaCount++;
+         }
+      }
+      delta_[k] = deltaCount > 0 ? deltaSum / deltaCount / cutoffFraction_ : 1.0;
+   }
+}
+
+auto FanBeamReconstruction::readConfig(const std::string& configFile) -> bool {
+   ConfigReader configReader = ConfigReader(configFile.data());
+   int samplingRate, scanRate;
+   float detectorDiameter;
+   if (configReader.lookupValue("numberOfFanDetectors", numberOfFanDetectors_)
+         && configReader.lookupValue("numberOfParallelDetectors", numberOfParallelDetectors_)
+         && configReader.lookupValue("numberOfPixels", numberOfPixels_)
+         && configReader.lookupValue("samplingRate", samplingRate)
+         && configReader.lookupValue("scanRate", scanRate)
+         && configReader.lookupValue("numberOfPlanes", numberOfPlanes_)
+         && configReader.lookupValue("sourceOffset", sourceOffset_)
+         && configReader.lookupValue("detectorDiameter", detectorDiameter)
+         && configReader.lookupValue("imageCenterX", imageCenterX_)
+         && configReader.lookupValue("imageCenterY", imageCenterY_)
+         && configReader.lookupValue("imageWidth", imageWidth_)
+         && configReader.lookupValue("rotationOffset", rotationOffset_)
+         && configReader.lookupValue("cutoffFraction", cutoffFraction_)
+         && configReader.lookupValue("blockSize2D_fanBeam", blockSize2D_)
+         && configReader.lookupValue("memPoolSize_fanBeam", memPoolSize_)) {
+      numberOfFanProjections_ = samplingRate * 1000000 / scanRate;
+      rDetector_ = detectorDiameter / 2.0;
+      for (auto i = 0; i < numberOfPlanes_; i++) {
+         float sourceDiameter;
+         if (!(configReader.lookupValue("sourceDiameter", i, sourceDiameter)
+               && configReader.lookupValue("deltaX", i, deltaX_[i])
+               && configReader.lookupValue("deltaZ", i, deltaZ_[i])
+               && configReader.lookupValue("sourceAngle", i, sourceAngle_[i])))
+            return EXIT_FAILURE;
+         rTarget_[i] = sourceDiameter / 2.0;
+      }
+      return EXIT_SUCCESS;
+   }
+
+   return EXIT_FAILURE;
+}
+
+__global__ void filterFanBeam(const fanSinogram_type* __restrict__ sinogram,
+      float* __restrict__ filtered, const float* __restrict__ fanAngles,
+      const float* __restrict__ weights, const int numberOfDetectors, const float delta) {
+
+   extern __shared__ float shared[];
+   float* weighted = shared;
+   float* psi = shared + numberOfDetectors;
+
+   const int projectionOffset = blockIdx.x * numberOfDetectors;
+   for (auto i = threadIdx.x; i < numberOfDetectors; i += blockDim.x) {
+      weighted[i] = toFloat(sinogram[projectionOffset + i]) * weights[projectionOffset + i];
+      psi[i] = fanAngles[projectionOffset + i];
+   }
+   __syncthreads();
+
+   const float invDelta = 1.0f / delta;
+   const float invDelta2 = invDelta * invDelta;
+   for (auto k = threadIdx.x; k < numberOfDetectors; k += blockDim.x) {
+      float sum = 0.0f;
+      for (auto i = 0; i < numberOfDetectors; i++) {
+         if (weighted[i] == 0.0f)
+            continue;
+         const float t = psi[k] - psi[i];
+         //band limited ramp filter: h(t) = 1/(2d^2) sinc(t/d) - 1/(4d^2) sinc^2(t/(2d))
+         float h = 0.25f * invDelta2;
+         float fanFactor = 0.5f;
+         if (fabsf(t) > 1e-6f) {
+            const float x = M_PI * t * invDelta;
+            const float sincFull = __sinf(x) / x;
+            const float sincHalf = __sinf(0.5f * x) / (0.5f * x);
+            h = 0.5f * invDelta2 * sincFull - 0.25f * invDelta2 * sincHalf * sincHalf;
+            const float ratio = t / __sinf(t);
+            fanFactor = 0.5f * ratio * ratio;
+         }
+         sum += weighted[i] * fanFactor * h;
+      }
+      filtered[projectionOffset + k] = sum;
+   }
+}
+
+__global__ void backProjectFanBeam(const float* __restrict__ filtered,
+      float* __restrict__ image, const float2* __restrict__ sources,
+      const float* __restrict__ sourceIncrements, const int numberOfPixels,
+      const int numberOfProjections, const int numberOfDetectors,
+      const float rDetector, const float pixelSize, const float centerX,
+      const float centerY, const float cosRotation, const float sinRotation,
+      const float outputScale) {
+
+   const auto x = glados::cuda::getX();
+   const auto y = glados::cuda::getY();
+
+   if (x >= numberOfPixels || y >= numberOfPixels)
+      return;
+
+   //pixel position in the same coordinate system as in the parallel beam back projection,
+   //the image center is applied as in the rebinning of Fan2Para
+   const float center = (numberOfPixels - 1.0f) * 0.5f;
+   const float xr = (x - center) * pixelSize;
+   const float yr = (y - center) * pixelSize;
+   const float px = xr * cosRotation + yr * sinRotation - centerY;
+   const float py = -xr * sinRotation + yr * cosRotation - centerX;
+
+   const float detectorScale = numberOfDetectors / (2.0f * M_PI);
+   const float rDetector2 = rDetector * rDetector;
+
+   float sum = 0.0f;
+   for (auto j = 0; j < numberOfProjections; j++) {
+      const float increment = sourceIncrements[j];
+      if (increment == 0.0f)
+         continue;
+      const float2 source = sources[j];
+      const float ux = px - source.x, uy = py - source.y;
+      const float distance2 = ux * ux + uy * uy;
+      const float invDistance = rsqrtf(distance2);
+      const float dx = ux * invDistance, dy = uy * invDistance;
+      //far intersection of the ray with the detector ring
+      const float b = source.x * dx + source.y * dy;
+      const float c = source.x * source.x + source.y * source.y - rDetector2;
+      const float lambda = -b + sqrtf(fmaxf(b * b - c, 0.0f));
+      const float hx = source.x + lambda * dx, hy = source.y + lambda * dy;
+      //detector index, gamma = 0 is located at 90 degrees
+      float detector = (atan2f(hy, hx) - 0.5f * M_PI) * detectorScale;
+      detector -= floorf(detector / numberOfDetectors) * numberOfDetectors;
+      const int i0 = min((int) detector, numberOfDetectors - 1);
+      const int i1 = (i0 + 1) % numberOfDetectors;
+      const float w = detector - i0;
+      const float value = (1.0f - w) * filtered[j * numberOfDetectors + i0] + w * filtered[j * numberOfDetectors + i1];
+      sum += increment / distance2 * value;
+   }
+   image[x + y * numberOfPixels] = sum * outputScale;
+}
+
+}
+}
@@ -24,6 +24,7 @@
 #include <risa/Filter/Filter.h>
 #include <risa/ConfigReader/ConfigReader.h>
 #include <risa/Basics/performance.h>
+#include <risa/Basics/geometry.h>
 #include "cuda_kernels_filter.h"
 
 #include <glados/cuda/Launch.h>
@@ -33,14 +34,67 @@
 
 #include <nvToolsExt.h>
 
+#ifdef RISA_CUFFT_CALLBACKS
+#include <cufftXt.h>
+#endif
+
+#include <algorithm>
 #include <exception>
+#include <functional>
 #include <pthread.h>
 
 namespace risa {
 namespace cuda {
 
+template <int X, int Y>
 __global__ void applyFilter(const int x, const int y, cufftComplex *data, const float* const __restrict__ filter);
 
+__global__ void padProjections(const float* __restrict__ sinogram, float* __restrict__ padded,
+      const int numberOfDetectors, const int numberOfPaddedDetectors, const int numberOfProjections);
+
+__global__ void unpadProjections(const float* __restrict__ padded, float* __restrict__ sinogram,
+      const int numberOfDetectors, const int numberOfPaddedDetectors, const int numberOfProjections);
+
+__global__ void convolveProjections(float* __restrict__ sinogram, const float* __restrict__ kernel,
+      const int numberOfDetectors);
+
+//! Returns the smallest length not less than size, that only has the prime factors 2, 3 and 5
+/**
+ * cuFFT is fastest for these lengths.
+ */
+auto nextSmoothSize(const int size) -> int {
+   for (auto candidate = std::max(size, 1);; candidate++) {
+      auto remainder = candidate;
+      for (auto factor : { 2, 3, 5 })
+         while (remainder % factor == 0)
+            remainder /= factor;
+      if (remainder == 1)
+         return candidate;
+   }
+}
+
+#ifdef RISA_CUFFT_CALLBACKS
+//! The data passed to the cuFFT load callback
+struct filterCallbackInfo {
+   const float* filter;    //!<  the filter function on the device
+   int filterSize;         //!<  the number of frequencies in one row of the R2C transformed sinogram
+};
+
+//!<  cuFFT load callback that weights the frequencies with the filter function
+/**
+ *    Replaces the applyFilter kernel: the filter function is applied while the inverse transformation
+ *    loads its input, which saves one pass over the frequency domain sinogram and one kernel launch.
+ */
+__device__ cufftComplex filterLoadCallback(void* dataIn, size_t offset, void* callerInfo, void* sharedPointer) {
+   const auto info = static_cast<const filterCallbackInfo*>(callerInfo);
+   const auto value = static_cast<const cufftComplex*>(dataIn)[offset];
+   const float weight = info->filter[offset % info->filterSize];
+   return make_cuComplex(value.x * weight, value.y * weight);
+}
+
+__device__ cufftCallbackLoadC filterLoadCallback_d = filterLoadCallback;
+#endif
+
 Filter::Filter(const std::string& configFile) {
 
    if (readConfig(configFile)) {
@@ -50,12 +104,17 @@ Filter::Filter(const std::string& configFile) {
 
    CHECK(cudaGetDeviceCount(&numberOfDevices_));
 
+   numberOfPaddedDetectors_ = nextSmoothSize(std::ceil(numberOfDetectors_ * paddingFactor_));
+   BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::Filter: Padding projections from " << numberOfDetectors_
+         << " to " << numberOfPaddedDetectors_ << " detectors.";
+
    //cuFFT library is initialized for each device
    for (auto i = 0; i < numberOfDevices_; i++) {
       initCuFFT(i);
    }
 
    designFilter();
+   designConvolutionKernel();
 
    //initialize worker threads
    for (auto i = 0; i < numberOfDevices_; i++) {
@@ -104,36 +163,120 @@ auto Filter::processor(const int deviceID) -> void {
    CHECK(cudaSetDevice(deviceID));
    auto sinoFreq = glados::cuda::make_device_ptr<cufftComplex,
          glados::cuda::async_copy_policy>(
-         numberOfProjections_ * ((numberOfDetectors_ / 2.0) + 1));
+         numberOfProjections_ * ((numberOfPaddedDetectors_ / 2) + 1));
+   //without padding, the sinogram is transformed in place
+   const bool usePadding = numberOfPaddedDetectors_ != numberOfDetectors_;
+   auto sinoPadded = glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(
+         usePadding ? numberOfProjections_ * numberOfPaddedDetectors_ : 0);
    dim3 dimBlock(blockSize2D_, blockSize2D_);
-   dim3 dimGrid((int) ceil((numberOfDetectors_ / 2.0 + 1) / (float) blockSize2D_),
+   dim3 dimGrid((int) ceil((numberOfPaddedDetectors_ / 2 + 1) / (float) blockSize2D_),
+         (int) ceil(numberOfProjections_ / (float) blockSize2D_));
+   dim3 dimGridPadded((int) ceil(numberOfPaddedDetectors_ / (float) blockSize2D_),
          (int) ceil(numberOfProjections_ / (float) blockSize2D_));
    auto filterFunction_d = glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(filter_.size());
    CHECK(cudaMemcpy(filterFunction_d.get(), filter_.data(), sizeof(float)*filter_.size(), cudaMemcpyHostToDevice));
-   BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::Filter: Running Thread for Device " << deviceID;
-   while (true) {
-      auto sinogram = sinograms_[deviceID].take();
-      if (!sinogram.valid())
-         break;
-      BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::Filter: Filtering sinogram with Index " << sinogram.index();
+#ifdef RISA_CUFFT_CALLBACKS
+   auto callbackInfo_d = glados::cuda::make_device_ptr<filterCallbackInfo>(1);
+   const filterCallbackInfo callbackInfo { filterFunction_d.get(), static_cast<int>(filter_.size()) };
+   CHECK(cudaMemcpy(callbackInfo_d.get(), &callbackInfo, sizeof(filterCallbackInfo), cudaMemcpyHostToDevice));
+   cufftCallbackLoadC loadCallback;
+   CHECK(cudaMemcpyFromSymbol(&loadCallback, filterLoadCallback_d, sizeof(cufftCallbackLoadC)));
+   void* callerInfo = callbackInfo_d.get();
+   CHECK_CUFFT(cufftXtSetCallback(plansInv_[deviceID], (void**) &loadCallback, CUFFT_CB_LD_COMPLEX, &callerInfo));
+   BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::Filter: Applying filter function in cuFFT load callback.";
+#else
+   //the specialized kernel is compiled for the padded and the unpadded production length
+   const int specializedLength = numberOfProjections_ != geometry::numberOfParallelProjections ? 0
+         : (numberOfPaddedDetectors_ == geometry::numberOfPaddedDetectors
+               || numberOfPaddedDetectors_ == geometry::numberOfParallelDetectors) ? numberOfPaddedDetectors_ : 0;
+   const auto filterKernel = geometry::selectKernel(specializedLength > 0,
+         geometry::selectKernel(specializedLength == geometry::numberOfPaddedDetectors,
+               applyFilter<geometry::numberOfPaddedDetectors / 2 + 1, geometry::numberOfParallelProjections>,
+               applyFilter<geometry::numberOfParallelDetectors / 2 + 1, geometry::numberOfParallelProjections>),
+         applyFilter<0, 0>);
+   BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::Filter: Using " << (specializedLength > 0 ? "specialized" : "generic") << " filter kernel.";
+#endif
+
+   //filtering in frequency domain
+   auto filterFFT = [&](float* data) {
+      //zero padding is performed while copying the projections into the transformation buffer
+      auto sinoReal = data;
+      if(usePadding){
+         padProjections<<<dimGridPadded, dimBlock, 0, streams_[deviceID]>>>(data,
+               sinoPadded.get(), numberOfDetectors_, numberOfPaddedDetectors_, numberOfProjections_);
+         CHECK(cudaPeekAtLastError());
+         sinoReal = sinoPadded.get();
+      }
 
       //forward transformation
       CHECK_CUFFT(
             cufftExecR2C(plansFwd_[deviceID],
-                  (cufftReal* ) sinogram.container().get(),
+                  (cufftReal* ) sinoReal,
                   thrust::raw_pointer_cast(&(sinoFreq[0]))));
 
-      //Filtering
-      applyFilter<<<dimGrid, dimBlock, 0, streams_[deviceID]>>>(
-            (numberOfDetectors_ / 2) + 1, numberOfProjections_, sinoFreq.get(), filterFunction_d.get());
+      //Filtering, performed by the load callback of the inverse transformation if enabled
+#ifndef RISA_CUFFT_CALLBACKS
+      filterKernel<<<dimGrid, dimBlock, 0, streams_[deviceID]>>>(
+            (numberOfPaddedDetectors_ / 2) + 1, numberOfProjections_, sinoFreq.get(), filterFunction_d.get());
 
       CHECK(cudaPeekAtLastError());
+#endif
 
       //reverse transformation
       CHECK_CUFFT(
             cufftExecC2R(plansInv_[deviceID],
                   thrust::raw_pointer_cast(sinoFreq.get()),
-                  (cufftReal* ) sinogram.container().get()));
+                  (cufftReal* ) sinoReal));
+
+      //the padded part of the projections is discarded while copying back
+      if(usePadding){
+         unpadProjections<<<dimGridPadded, dimBlock, 0, streams_[deviceID]>>>(sinoPadded.get(),
+               data, numberOfDetectors_, numberOfPaddedDetectors_, numberOfProjections_);
+         CHECK(cudaPeekAtLastError());
+      }
+   };
+
+   //filtering in spatial domain, one block per projection
+   auto convolutionKernel_d = glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(convolutionKernel_.size());
+   CHECK(cudaMemcpy(convolutionKernel_d.get(), convolutionKernel_.data(), sizeof(float)*convolutionKernel_.size(), cudaMemcpyHostToDevice));
+   const int convolutionBlockSize = std::min(1024, (numberOfDetectors_ + 31) / 32 * 32);
+   const std::size_t convolutionSharedMemory = sizeof(float) * (numberOfDetectors_ + convolutionKernel_.size());
+   auto filterConvolution = [&](float* data) {
+      convolveProjections<<<numberOfProjections_, convolutionBlockSize, convolutionSharedMemory, streams_[deviceID]>>>(
+            data, convolutionKernel_d.get(), numberOfDetectors_);
+      CHECK(cudaPeekAtLastError());
+   };
+
+   //the projection and the filter kernel need to fit into the shared memory of one block
+   const bool convolutionPossible = convolutionSharedMemory <= 48 * 1024;
+   if(!convolutionPossible && filterImplementation_ == detail::FilterImplementation::convolution)
+      BOOST_LOG_TRIVIAL(warning) << "recoLib::cuda::Filter: Too many detectors for convolution filtering. Using FFT.";
+
+   auto useConvolution = convolutionPossible && filterImplementation_ == detail::FilterImplementation::convolution;
+   if(convolutionPossible && filterImplementation_ == detail::FilterImplementation::automatic){
+      //measure both implementations once on a dummy sinogram
+      auto benchmarkSinogram = glados::cuda::make_device_ptr<float, glados::cuda::async_copy_policy>(numberOfProjections_ * numberOfDetectors_);
+      CHECK(cudaMemsetAsync(benchmarkSinogram.get(), 0, sizeof(float) * numberOfProjections_ * numberOfDetectors_, streams_[deviceID]));
+      const float timeFFT = benchmarkFilter(deviceID, filterFFT, benchmarkSinogram.get());
+      const float timeConvolution = benchmarkFilter(deviceID, filterConvolution, benchmarkSinogram.get());
+      useConvolution = timeConvolution < timeFFT;
+      BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::Filter: FFT filtering takes " << timeFFT << " ms, convolution takes "
+            << timeConvolution << " ms on device " << deviceID << ".";
+   }
+   BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::Filter: Using " << (useConvolution ? "convolution" : "FFT") << " filtering on device " << deviceID << ".";
+
+   BOOST_LOG_TRIVIAL(info) << "recoLib::cuda::Filter: Running Thread for Device " << deviceID;
+   while (true) {
+      auto sinogram = sinograms_[deviceID].take();
+      if (!sinogram.valid())
+         break;
+      BOOST_LOG_TRIVIAL(debug)<< "recoLib::cuda::Filter: Filtering sinogram with Index " << sinogram.index();
+
+      if(useConvolution)
+         filterConvolution(sinogram.container().get());
+      else
+         filterFFT(sinogram.container().get());
+
       //wait until work on device is finished
       CHECK(cudaStreamSynchronize(streams_[deviceID]));
       results_.push(std::move(sinogram));
@@ -142,6 +285,25 @@ auto Filter::processor(const int deviceID) -> void {
    }
 }
 
+auto Filter::benchmarkFilter(const int deviceID, const std::function<void(float*)>& filter, float* data) -> float {
+   const auto repetitions = 20;
+   cudaEvent_t start, stop;
+   CHECK(cudaEventCreate(&start));
+   CHECK(cudaEventCreate(&stop));
+   //warm up
+   filter(data);
+   CHECK(cudaEventRecord(start, streams_[deviceID]));
+   for(auto i = 0; i < repetitions; i++)
+      filter(data);
+   CHECK(cudaEventRecord(stop, streams_[deviceID]));
+   CHECK(cudaEventSynchronize(stop));
+   float milliseconds;
+   CHECK(cudaEventElapsedTime(&milliseconds, start, stop));
+   CHECK(cudaEventDestroy(start));
+   CHECK(cudaEventDestroy(stop));
+   return milliseconds / repetitions;
+}
+
 auto Filter::initCuFFT(const int deviceID) -> void {
 
    CHECK(cudaSetDevice(deviceID));
@@ -153,12 +315,12 @@ auto Filter::initCuFFT(const int deviceID) -> void {
    streams_[deviceID] = stream;
 
    CHECK_CUFFT(
-         cufftPlanMany(&planFwd, 1, &numberOfDetectors_, NULL, 0, 0, NULL, 0, 0, CUFFT_R2C, numberOfProjections_));
+         cufftPlanMany(&planFwd, 1, &numberOfPaddedDetectors_, NULL, 0, 0, NULL, 0, 0, CUFFT_R2C, numberOfProjections_));
 
    CHECK_CUFFT(cufftSetStream(planFwd, stream));
 
    CHECK_CUFFT(
-         cufftPlanMany(&planInv, 1, &numberOfDetectors_, NULL, 0, 0, NULL, 0, 0, CUFFT_C2R, numberOfProjections_));
+         cufftPlanMany(&planInv, 1, &numberOfPaddedDetectors_, NULL, 0, 0, NULL, 0, 0, CUFFT_C2R, numberOfProjections_));
 
    CHECK_CUFFT(cufftSetStream(planInv, stream));
 
@@ -167,17 +329,17 @@ auto Filter::initCuFFT(const int deviceID) -> void {
 }
 
 auto Filter::designFilter() -> void {
-   int filterSize = numberOfDetectors_/2 + 1;
+   int filterSize = numberOfPaddedDetectors_/2 + 1;
    filter_.reserve(filterSize);
    filter_.push_back(0.0);
    for(auto i = 1; i < filterSize; i++){
       //actual w at frequency axis
-      const float w = 2 * M_PI * i / (float)numberOfDetectors_;
+      const float w = 2 * M_PI * i / (float)numberOfPaddedDetectors_;
       if(w > M_PI*cutoffFraction_){
          filter_.push_back(0.0);
          continue;
       }
-      float filterValue = 2 * i / (float)numberOfDetectors_; //* hanning(w, (float)1.0);
+      float filterValue = 2 * i / (float)numberOfPaddedDetectors_; //* hanning(w, (float)1.0);
       if(filterType_ == detail::FilterType::hamming)
          filterValue *= hamming(w, cutoffFraction_);
       else if(filterType_ == detail::FilterType::hanning)
@@ -186,13 +348,48 @@ auto Filter::designFilter() -> void {
          filterValue *= sheppLogan(w, cutoffFraction_);
       else if(filterType_ == detail::FilterType::cosine)
          filterValue *= cosine(w, cutoffFraction_);
-      filter_.push_back(filterValue/(float)numberOfDetectors_);
+      filter_.push_back(filterValue/(float)numberOfPaddedDetectors_);
+   }
+}
+
+auto Filter::designConvolutionKernel() -> void {
+   //the FFT filtering is a circular convolution with the inverse transform of the filter function
+   //on the padded grid, it is evaluated for all distances between two detectors of one projection
+   const auto filterSize = static_cast<int>(filter_.size());
+   convolutionKernel_.resize(2 * numberOfDetectors_ - 1);
+   for(auto d = -(numberOfDetectors_ - 1); d < numberOfDetectors_; d++){
+      double value = filter_[0];
+      for(auto k = 1; k < filterSize; k++){
+         //the Nyquist frequency only appears once for even lengths
+         const double weight = (2 * k == numberOfPaddedDetectors_) ? 1.0 : 2.0;
+         value += weight * filter_[k] * std::cos(2.0 * M_PI * k * d / numberOfPaddedDetectors_);
+      }
+      convolutionKernel_[d + numberOfDetectors_ - 1] = value;
    }
 }
 
 auto Filter::readConfig(const std::string& configFile) -> bool {
    ConfigReader configReader = ConfigReader(configFile.data());
    std::string filterType;
+   //optional parameter, no zero padding if not specified
+   paddingFactor_ = 1.0;
+   configReader.lookupValue("filterPaddingFactor", paddingFactor_);
+   //optional parameter, the faster implementation is chosen at startup if not specified
+   std::string filterImplementation = "auto";
+   configReader.lookupValue("filterImplementation", filterImplementation);
+   if(filterImplementation == "fft")
+      filterImplementation_ = detail::FilterImplementation::fft;
+   else if(filterImplementation == "convolution")
+      filterImplementation_ = detail::FilterImplementation::convolution;
+   else{
+      if(filterImplementation != "auto")
+         BOOST_LOG_TRIVIAL(warning) << "recoLib::cuda::Filter: Requested filter implementation not supported. Choosing automatically.";
+      filterImplementation_ = detail::FilterImplementation::automatic;
+   }
+   if(paddingFactor_ < 1.0){
+      BOOST_LOG_TRIVIAL(warning) << "recoLib::cuda::Filter: Padding factor needs to be at least 1. Using 1.";
+      paddingFactor_ = 1.0;
+   }
    if (configReader.lookupValue("numberOfParallelProjections", numberOfProjections_)
          && configReader.lookupValue("numberOfParallelDetectors", numberOfDetectors_)
          && configReader.lookupValue("numberOfPixels", numberOfPixels_)
@@ -227,8 +424,14 @@ auto Filter::readConfig(const std::string& configFile) -> bool {
  *    @param[in]  y  the number of projections in the parallel beam sinogram
  *    @param[in,out] data  the inverse transformed parallel ray sinogram
  *    @param[in]  filter   pointer to the precomputed filter function
+ *
+ *    @tparam X  compile time value of x, zero if the runtime value shall be used
+ *    @tparam Y  compile time value of y, zero if the runtime value shall be used
  */
-__global__ void applyFilter(const int x, const int y, cufftComplex *data , const float* const __restrict__ filter) {
+template <int X, int Y>
+__global__ void applyFilter(const int xRuntime, const int yRuntime, cufftComplex *data , const float* const __restrict__ filter) {
+   const int x = geometry::select<X>(xRuntime);
+   const int y = geometry::select<Y>(yRuntime);
    const int j = blockIdx.y * blockDim.y + threadIdx.y;
    const int i = blockIdx.x * blockDim.x + threadIdx.x;
    if (i < x && j < y) {
@@ -240,5 +443,64 @@ __global__ void applyFilter(const int x, const int y, cufftComplex *data , const
    }
 }
 
+//!<  CUDA Kernel that copies the projections into the zero padded transformation buffer
+/**
+ *    The padded detectors are set to zero in the same pass, a separate initialization is not necessary.
+ *
+ *    @param[in]  sinogram   the parallel beam sinogram
+ *    @param[out] padded     the zero padded parallel beam sinogram
+ */
+__global__ void padProjections(const float* __restrict__ sinogram, float* __restrict__ padded,
+      const int numberOfDetectors, const int numberOfPaddedDetectors, const int numberOfProjections) {
+   const int j = blockIdx.y * blockDim.y + threadIdx.y;
+   const int i = blockIdx.x * blockDim.x + threadIdx.x;
+   if (i < numberOfPaddedDetectors && j < numberOfProjections)
+      padded[i + j * numberOfPaddedDetectors] = i < numberOfDetectors ? sinogram[i + j * numberOfDetectors] : 0.0f;
+}
+
+//!<  CUDA Kernel that copies the filtered projections back and discards the padded detectors
+/**
+ *    @param[in]  padded     the filtered, zero padded parallel beam sinogram
+ *    @param[out] sinogram   the filtered parallel beam sinogram
+ */
+__global__ void unpadProjections(const float* __restrict__ padded, float* __restrict__ sinogram,
+      const int numberOfDetectors, const int numberOfPaddedDetectors, const int numberOfProjections) {
+   const int j = blockIdx.y * blockDim.y + threadIdx.y;
+   const int i = blockIdx.x * blockDim.x + threadIdx.x;
+   if (i < numberOfDetectors && j < numberOfProjections)
+      sinogram[i + j * numberOfDetectors] = padded[i + j * numberOfPaddedDetectors];
+}
+
+//!<  CUDA Kernel that convolves the projections with the spatial domain filter kernel
+/**
+ *    One block filters one projection in place. The projection and the filter kernel are
+ *    staged in shared memory, which needs to hold 3 * numberOfDetectors - 1 values.
+ *
+ *    @param[in,out] sinogram  the parallel beam sinogram
+ *    @param[in]     kernel    the filter kernel for the distances -(numberOfDetectors-1) to numberOfDetectors-1
+ */
+__global__ void convolveProjections(float* __restrict__ sinogram, const float* __restrict__ kernel,
+      const int numberOfDetectors) {
+   extern __shared__ float shared[];
+   float* projection = shared;
+   float* filterKernel = shared + numberOfDetectors;
+   float* row = sinogram + blockIdx.x * numberOfDetectors;
+
+   for(auto i = threadIdx.x; i < numberOfDetectors; i += blockDim.x)
+      projection[i] = row[i];
+   for(auto i = threadIdx.x; i < 2 * numberOfDetectors - 1; i += blockDim.x)
+      filterKernel[i] = kernel[i];
+   __syncthreads();
+
+   for(int i = threadIdx.x; i < numberOfDetectors; i += blockDim.x){
+      //filterKernel[i - m + numberOfDetectors - 1] is the weight for the distance i - m
+      const float* weights = filterKernel + i + numberOfDetectors - 1;
+      float sum = 0.0f;
+      for(auto m = 0; m < numberOfDetectors; m++)
+         sum += projection[m] * weights[-m];
+      row[i] = sum;
+   }
+}
+
 }
 }
@@ -40,7 +40,7 @@ OfflineLoader::OfflineLoader(const std::string& address,
             "recoLib::OfflineLoader: Configuration file could not be loaded successfully. Please check!");
    }
 
-   numberOfDetectorsPerModule_ = numberOfDetectors_ / numberOfDetectorModules_;
+   numberOfDetectorsPerModule_ = layout_.numberOfDetectorsPerModule();
 
    memoryPoolIndex_ = glados::MemoryPool<manager_type>::instance()->registerStage(
          250, numberOfProjections_ * numberOfDetectors_);
@@ -81,9 +81,10 @@ auto OfflineLoader::readInput() -> void {
    if (path_.back() != '/')
       path_.append("/");
 
-   for (auto i = 1; i <= numberOfDetectorModules_; i++) {
+   //the files are numbered by the physical module id, starting at 1
+   for (auto i = 0; i < numberOfDetectorModules_; i++) {
       auto ifStream = std::unique_ptr <std::ifstream> (new std::ifstream(
-                  path_ + fileName_ + std::to_string(i) + fileEnding_,
+                  path_ + fileName_ + std::to_string(layout_.module(i) + 1) + fileEnding_,
                   std::ios::in | std::ios::binary));
       ifstreams_.push_back(std::move(ifStream));
    }
@@ -106,8 +107,7 @@ auto OfflineLoader::readConfig(const std::string& configFile) -> bool {
    ConfigReader configReader = ConfigReader(configFile.data());
    int samplingRate, scanRate;
    if (configReader.lookupValue("numberOfFanDetectors", numberOfDetectors_)
-         && configReader.lookupValue("numberOfDetectorModules",
-               numberOfDetectorModules_)
+         && !layout_.readConfig(configFile)
          && configReader.lookupValue("dataInputPath", path_)
          && configReader.lookupValue("dataFileName", fileName_)
          && configReader.lookupValue("dataFileEnding", fileEnding_)
@@ -115,6 +115,7 @@ auto OfflineLoader::readConfig(const std::string& configFile) -> bool {
          && configReader.lookupValue("samplingRate", samplingRate)
          && configReader.lookupValue("scanRate", scanRate)
          && configReader.lookupValue("numberOfDataFrames", numberOfFrames_)) {
+      numberOfDetectorModules_ = layout_.numberOfModules();
       numberOfProjections_ = samplingRate * 1000000 / scanRate;
       return EXIT_SUCCESS;
    }
@@ -30,6 +30,7 @@
 #include <exception>
 #include <fstream>
 #include <chrono>
+#include <algorithm>
 
 namespace risa {
 
@@ -85,15 +86,16 @@ auto OfflineLoaderPerfTest::readInput() -> void {
    Timer tmr1, tmr2;
    std::vector<std::vector<unsigned short>> fileContents(
          numberOfDetectorModules_);
-   int numberOfDetPerModule = numberOfDetectors_ / numberOfDetectorModules_;
+   int numberOfDetPerModule = layout_.numberOfDetectorsPerModule();
    if (path_.back() != '/')
       path_.append("/");
    tmr1.start();
    tmr2.start();
-#pragma omp parallel for default(shared) num_threads(numberOfDetectorModules_/3)
-   for (auto i = 1; i <= numberOfDetectorModules_; i++) {
+#pragma omp parallel for default(shared) num_threads(std::max(numberOfDetectorModules_/3, 1))
+   for (auto i = 0; i < numberOfDetectorModules_; i++) {
       std::vector<unsigned short> content;
-      std::ifstream input(path_ + fileName_ + std::to_string(i) + fileEnding_,
+      //the files are numbered by the physical module id, starting at 1
+      std::ifstream input(path_ + fileName_ + std::to_string(layout_.module(i) + 1) + fileEnding_,
             std::ios::in | std::ios::binary);
       if (!input) {
          BOOST_LOG_TRIVIAL(error)<< "recoLib::OfflineLoader: Source file could not be loaded.";
@@ -106,7 +108,7 @@ auto OfflineLoaderPerfTest::readInput() -> void {
       input.seekg(0, std::ios::beg);
       content.resize(fileSize / sizeof(unsigned short));
       input.read((char*) &content[0], fileSize);
-      fileContents[i - 1] = content;
+      fileContents[i] = content;
    }
    tmr2.stop();
    for (unsigned int i = 0; i < numberOfFrames_; i++) {
@@ -143,8 +145,7 @@ auto OfflineLoaderPerfTest::readConfig(const std::string& configFile) -> bool {
    ConfigReader configReader = ConfigReader(configFile.data());
    int samplingRate, scanRate;
    if (configReader.lookupValue("numberOfFanDetectors", numberOfDetectors_)
-         && configReader.lookupValue("numberOfDetectorModules",
-               numberOfDetectorModules_)
+         && !layout_.readConfig(configFile)
          && configReader.lookupValue("dataInputPath", path_)
          && configReader.lookupValue("dataFileName", fileName_)
          && configReader.lookupValue("dataFileEnding", fileEnding_)
@@ -152,6 +153,7 @@ auto OfflineLoaderPerfTest::readConfig(const std::string& configFile) -> bool {
          && configReader.lookupValue("samplingRate", samplingRate)
          && configReader.lookupValue("scanRate", scanRate)
          && configReader.lookupValue("numberOfDataFrames", numberOfFrames_)) {
+      numberOfDetectorModules_ = layout_.numberOfModules();
       numberOfProjections_ = samplingRate * 1000000 / scanRate;
       return EXIT_SUCCESS;
    }
@@ -24,6 +24,8 @@
 #include <risa/Reordering/Reordering.h>
 #include <risa/ConfigReader/ConfigReader.h>
 #include <risa/Basics/performance.h>
+#include <risa/Basics/geometry.h>
+#include <risa/Basics/DetectorLayout.h>
 
 #include <glados/cuda/Launch.h>
 #include <glados/cuda/Check.h>
@@ -40,8 +42,14 @@
 namespace risa {
 namespace cuda {
 
+template <int NumberOfDetectors, int NumberOfProjections, int NumberOfDetectorsPerModule>
 __global__ void reorder(const unsigned short* __restrict__ unorderedSino, unsigned short* __restrict__ orderedSino,
-      const int* __restrict__ hashTable, const int numberOfProjections, const int numberOfDetectors);
+      const int numberOfProjections, const int numberOfDetectors, const int numberOfDetectorsPerModule);
+
+//! the number of projections transposed by one thread block
+constexpr int tileProjections = 16;
+//! the number of threads per block of the transpose kernel
+constexpr int blockSizeReordering = 256;
 
 Reordering::Reordering(const std::string& configFile) {
 
@@ -108,25 +116,25 @@ auto Reordering::wait() -> output_type {
 }
 
 /**
- * The processor()-Method takes one sinogram from the queue. Via the cuFFT-Library
- * it is transformed into frequency space for applying the filter function.
- * After filtering the transformation is reverted via the inverse fourier transform.
- * Finally, the filtered sinogram is pushed back into the output queue for
- * further processing.
+ * The processor()-Method takes one sinogram from the queue. The module ordered
+ * raw data is transposed tile by tile into a sinogram ordered by projections and
+ * detectors, which is pushed into the output queue for further processing.
  *
  */
 auto Reordering::processor(const int deviceID) -> void {
    //nvtxNameOsThreadA(pthread_self(), "CropImage");
    CHECK(cudaSetDevice(deviceID));
-   dim3 blocks(16, 16);
-   dim3 grids(std::ceil(numberOfFanDetectors_/16.0),
-         std::ceil(numberOfFanProjections_/16.0));
-
-   std::vector<int> hashTable(numberOfFanDetectors_*numberOfFanProjections_);
-   createHashTable(hashTable);
-
-   auto d_hashTable = glados::cuda::make_device_ptr<int>(numberOfFanDetectors_*numberOfFanProjections_);
-   CHECK(cudaMemcpy(d_hashTable.get(), hashTable.data(), sizeof(int)*hashTable.size(), cudaMemcpyHostToDevice));
+   dim3 blocks(blockSizeReordering);
+   dim3 grids(std::ceil(numberOfFanProjections_/(float)tileProjections));
+   const std::size_t sharedMemory = sizeof(unsigned short) * tileProjections * numberOfFanDetectors_;
+
+   const bool useSpecializedKernel = numberOfFanDetectors_ == geometry::numberOfFanDetectors
+         && numberOfFanProjections_ == geometry::numberOfFanProjections
+         && numberOfDetectorsPerModule_ == geometry::numberOfDetectorsPerModule;
+   const auto reorderKernel = geometry::selectKernel(useSpecializedKernel,
+         reorder<geometry::numberOfFanDetectors, geometry::numberOfFanProjections, geometry::numberOfDetectorsPerModule>,
+         reorder<0, 0, 0>);
+   BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::Reordering: Using " << (useSpecializedKernel ? "specialized" : "generic") << " reordering kernel.";
 
    BOOST_LOG_TRIVIAL(info)<< "recoLib::cuda::Reordering: Running Thread for Device " << deviceID;
    while (true) {
@@ -137,7 +145,8 @@ auto Reordering::processor(const int deviceID) -> void {
 
       auto sino_ordered = glados::MemoryPool<deviceManagerType>::instance()->requestMemory(memoryPoolIdxs_[deviceID]);
 
-      reorder<<<grids, blocks, 0, streams_[deviceID]>>>(img.container().get(), sino_ordered.container().get(), d_hashTable.get(), numberOfFanProjections_, numberOfFanDetectors_);
+      reorderKernel<<<grids, blocks, sharedMemory, streams_[deviceID]>>>(img.container().get(), sino_ordered.container().get(),
+            numberOfFanProjections_, numberOfFanDetectors_, numberOfDetectorsPerModule_);
       CHECK(cudaPeekAtLastError());
 
       sino_ordered.setIdx(img.index());
@@ -164,11 +173,13 @@ auto Reordering::processor(const int deviceID) -> void {
 auto Reordering::readConfig(const std::string& configFile) -> bool {
    ConfigReader configReader = ConfigReader(configFile.data());
    int samplingRate, scanRate;
+   DetectorLayout layout;
    if (configReader.lookupValue("numberOfFanDetectors", numberOfFanDetectors_)
          && configReader.lookupValue("memPoolSize_Reordering", memPoolSize_)
          && configReader.lookupValue("samplingRate", samplingRate)
-         && configReader.lookupValue("scanRate", scanRate)){
-      numberOfDetectorsPerModule_ = 16;
+         && configReader.lookupValue("scanRate", scanRate)
+         && !layout.readConfig(configFile)){
+      numberOfDetectorsPerModule_ = layout.numberOfDetectorsPerModule();
       numberOfFanProjections_ = samplingRate * 1000000 / scanRate;
       return EXIT_SUCCESS;
    }
@@ -177,32 +188,39 @@ auto Reordering::readConfig(const std::string& configFile) -> bool {
 
 }
 
-auto Reordering::createHashTable(std::vector<int>& hashTable) -> void {
-   int numberOfModules = 27;
-   int i = 0;
-   hashTable.resize(numberOfFanProjections_*numberOfFanDetectors_);
-   for(auto projInd = 0; projInd < numberOfFanProjections_; projInd++){
-      for(auto modInd = 0; modInd < numberOfModules; modInd++){
-         for(auto detInd = 0; detInd < numberOfDetectorsPerModule_; detInd++){
-            int index = detInd + projInd * numberOfDetectorsPerModule_ + modInd * numberOfDetectorsPerModule_*numberOfFanProjections_;
-            hashTable[i] = index;
-            i++;
-         }
-      }
+template <int NumberOfDetectors, int NumberOfProjections, int NumberOfDetectorsPerModule>
+__global__ void reorder(const unsigned short* __restrict__ unorderedSino, unsigned short* __restrict__ orderedSino,
+      const int numberOfProjectionsRuntime, const int numberOfDetectorsRuntime, const int numberOfDetectorsPerModuleRuntime) {
+   const int numberOfDetectors = geometry::select<NumberOfDetectors>(numberOfDetectorsRuntime);
+   const int numberOfProjections = geometry::select<NumberOfProjections>(numberOfProjectionsRuntime);
+   const int numberOfDetectorsPerModule = geometry::select<NumberOfDetectorsPerModule>(numberOfDetectorsPerModuleRuntime);
+
+   extern __shared__ unsigned short tile[];
+
+   //the input consists of one block of numberOfProjections x numberOfDetectorsPerModule values per module,
+   //the output of one row of numberOfDetectors values per projection
+   const int firstProjection = blockIdx.x * tileProjections;
+   const int projectionsInTile = min(tileProjections, numberOfProjections - firstProjection);
+   const int moduleTileSize = projectionsInTile * numberOfDetectorsPerModule;
+   const int tileSize = projectionsInTile * numberOfDetectors;
+
+   //each module contributes one contiguous segment to the tile, read all of them coalesced
+   for (int i = threadIdx.x; i < tileSize; i += blockDim.x) {
+      const int module = i / moduleTileSize;
+      const int inModule = i - module * moduleTileSize;
+      const int projection = inModule / numberOfDetectorsPerModule;
+      const int detector = inModule - projection * numberOfDetectorsPerModule;
+      tile[projection * numberOfDetectors + module * numberOfDetectorsPerModule + detector] =
+            unorderedSino[module * numberOfProjections * numberOfDetectorsPerModule
+                  + firstProjection * numberOfDetectorsPerModule + inModule];
    }
-}
+   __syncthreads();
 
-__global__ void reorder(const unsigned short* __restrict__ unorderedSino, unsigned short* __restrict__ orderedSino,
-      const int* __restrict__ hashTable, const int numberOfProjections, const int numberOfDetectors) {
-   const auto x = glados::cuda::getX();
-   const auto y = glados::cuda::getY();
-   if (x >= numberOfDetectors || y >= numberOfProjections)
-      return;
-
-   const int index = x + y * numberOfDetectors;
-   orderedSino[index] = unorderedSino[hashTable[index]];
+   //the reordered tile is one contiguous segment of the output
+   unsigned short* out = orderedSino + firstProjection * numberOfDetectors;
+   for (int i = threadIdx.x; i < tileSize; i += blockDim.x)
+      out[i] = tile[i];
 }
 
 }
 }
-
@@ -27,38 +27,53 @@
 
 #include <glados/MemoryPool.h>
 
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 
 namespace risa {
 
-Receiver::Receiver(const std::string& address, const std::string& configPath) : notification_{27}{
+Receiver::Receiver(const std::string& address, const std::string& configPath) {
 
    if (readConfig(configPath)) {
       BOOST_LOG_TRIVIAL(error) << "Configuration file could not be read successfully. Please check!";
       throw std::runtime_error("Receiver: Configuration file could not be loaded successfully. Please check!");
    }
 
-   for(auto i = 0u; i < numberOfDetectorModules_; i++){
-      BOOST_LOG_TRIVIAL(debug) << "Creating receivermodule: " << i;
-      buffers_.emplace(std::piecewise_construct, std::make_tuple(i), std::make_tuple(bufferSize_*(numberOfDetectors_/numberOfDetectorModules_)*numberOfProjections_));
-   }
+   ring_.reset(new InputRing(bufferSize_, numberOfDetectors_*numberOfProjections_, 100));
 
    modules_.reserve(numberOfDetectorModules_);
    for(auto i = 0; i < numberOfDetectorModules_; i++){
-      modules_.emplace_back(address, configPath, i, buffers_[i], notification_);
+      BOOST_LOG_TRIVIAL(debug) << "Creating receivermodule: " << i;
+      modules_.emplace_back(address, configPath, i, layout_, *ring_, notification_);
    }
 
-   memoryPoolIndex_ = glados::MemoryPool<manager_type>::instance()->registerStage(100, numberOfDetectors_*numberOfProjections_);
-
-   for(auto i = 0u; i < numberOfDetectorModules_; i++){
-      std::function<void(void)> f = [=]() {
-         modules_[i].run();
-      };
-      moduleThreads_.emplace_back(f);
+   if(transportProtocol_ == transportProtocol::UDP){
+      //a few threads wait for packets on all module sockets, the modules are distributed round robin
+      const int numberOfThreads = std::max(1, std::min(numberOfReceiverThreads_, numberOfDetectorModules_));
+      for(auto threadInd = 0; threadInd < numberOfThreads; threadInd++){
+         std::vector<int> moduleIDs;
+         for(auto i = threadInd; i < numberOfDetectorModules_; i += numberOfThreads)
+            moduleIDs.push_back(i);
+         moduleThreads_.emplace_back(&Receiver::receive, this, moduleIDs);
+      }
+      BOOST_LOG_TRIVIAL(info) << "Receiver: " << numberOfThreads << " threads receive from " << numberOfDetectorModules_ << " detector modules.";
+   }else{
+      for(auto i = 0u; i < numberOfDetectorModules_; i++){
+         std::function<void(void)> f = [=]() {
+            modules_[i].run();
+         };
+         moduleThreads_.emplace_back(f);
+      }
    }
 
-   for(auto i = 0u; i < numberOfDetectorModules_; i++){
-      moduleThreads_[i].detach();
+   for(auto& thread: moduleThreads_){
+      thread.detach();
    }
 }
 
@@ -66,35 +81,94 @@ auto Receiver::run() -> void {
 
 }
 
+auto Receiver::receive(std::vector<int> moduleIDs) -> void {
+   using clock = std::chrono::steady_clock;
+   const auto timeout = std::chrono::seconds(timeout_);
+   int epollFd = epoll_create1(0);
+   if(epollFd < 0){
+      BOOST_LOG_TRIVIAL(error) << "Receiver: Could not create epoll instance: " << std::strerror(errno);
+      for(auto moduleID: moduleIDs)
+         modules_[moduleID].finish();
+      return;
+   }
+   std::vector<clock::time_point> lastPacket(numberOfDetectorModules_, clock::now());
+   for(auto moduleID: moduleIDs){
+      epoll_event event;
+      event.events = EPOLLIN;
+      event.data.u32 = moduleID;
+      epoll_ctl(epollFd, EPOLL_CTL_ADD, modules_[moduleID].eventFd(), &event);
+   }
+   std::vector<epoll_event> events(moduleIDs.size());
+   while(!moduleIDs.empty()){
+      //wait until the module, that is idle for the longest time, reaches the timeout
+      auto deadline = lastPacket[moduleIDs.front()];
+      for(auto moduleID: moduleIDs)
+         deadline = std::min(deadline, lastPacket[moduleID]);
+      deadline += timeout;
+      const auto waitTime = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now());
+      int numEvents = epoll_wait(epollFd, events.data(), events.size(), std::max(0, (int)waitTime.count()));
+      if(numEvents < 0 && errno != EINTR){
+         BOOST_LOG_TRIVIAL(error) << "Receiver: epoll_wait failed: " << std::strerror(errno);
+         break;
+      }
+      const auto now = clock::now();
+      for(auto eventInd = 0; eventInd < numEvents; eventInd++){
+         const int moduleID = events[eventInd].data.u32;
+         if(modules_[moduleID].receiveBatch() > 0)
+            lastPacket[moduleID] = now;
+      }
+      //modules, which did not receive packets within the timeout, are finished
+      auto idle = std::partition(moduleIDs.begin(), moduleIDs.end(), [&](int moduleID){
+         return now - lastPacket[moduleID] < timeout;
+      });
+      for(auto it = idle; it != moduleIDs.end(); it++){
+         epoll_ctl(epollFd, EPOLL_CTL_DEL, modules_[*it].eventFd(), nullptr);
+         modules_[*it].finish();
+      }
+      moduleIDs.erase(idle, moduleIDs.end());
+   }
+   for(auto moduleID: moduleIDs)
+      modules_[moduleID].finish();
+   close(epollFd);
+}
+
 auto Receiver::loadImage() -> glados::Image<manager_type> {
-   int numberOfDetectorsPerModule = 16;
-   //create sinograms here
-   std::size_t index = notification_.fetch();
-   if(index == -1) return glados::Image<manager_type>();
-   auto sino = glados::MemoryPool<manager_type>::instance()->requestMemory(memoryPoolIndex_);
-
-   for(auto detModInd = 0; detModInd < numberOfDetectorModules_; detModInd++){
-      std::size_t startIndex = (index%bufferSize_) * numberOfDetectorsPerModule*numberOfProjections_;
-      std::copy(buffers_[detModInd].cbegin() + startIndex,
-            buffers_[detModInd].cbegin() + startIndex + numberOfDetectorsPerModule*numberOfProjections_,
-            sino.container().get() + detModInd * numberOfDetectorsPerModule * numberOfProjections_);
+   glados::Image<manager_type> sino;
+   std::size_t index;
+   while(!sino.valid()){
+      //may block until the pipeline releases an image, so it must not happen between fetch and take
+      ring_->prepare();
+      index = notification_.fetch();
+      if(index == -1) return glados::Image<manager_type>();
+      //the sinogram is already stored module by module in pinned memory, it leaves the ring buffer without copy
+      sino = ring_->take(index);
+      if(!sino.valid())
+         BOOST_LOG_TRIVIAL(warning) << "Receiver: Sinogram " << index << " was overwritten in the input buffer before it was passed on, skipping it.";
    }
    sino.setIdx(index);
    sino.setPlane(index%2);
    sino.setStart(std::chrono::high_resolution_clock::now());
 
-   return std::move(sino);
+   return sino;
 }
 
 auto Receiver::readConfig(const std::string& configFile) -> bool {
   ConfigReader configReader = ConfigReader(configFile.data());
   int samplingRate, scanRate;
+  std::string transportProt;
   if (configReader.lookupValue("samplingRate", samplingRate)
         && configReader.lookupValue("numberOfFanDetectors", numberOfDetectors_)
         && configReader.lookupValue("scanRate", scanRate)
         && configReader.lookupValue("inputBufferSize", bufferSize_)
-        && configReader.lookupValue("numberOfDetectorModules", numberOfDetectorModules_)) {
+        && configReader.lookupValue("transportProtocol", transportProt)
+        && configReader.lookupValue("timeout", timeout_)
+        && !layout_.readConfig(configFile)) {
+     numberOfDetectorModules_ = layout_.numberOfModules();
      numberOfProjections_ = samplingRate * 1000000 / scanRate;
+     notification_.resize(numberOfDetectorModules_, bufferSize_);
+     transportProtocol_ = transportProt == "tcp" ? transportProtocol::TCP : transportProtocol::UDP;
+     //optional parameter, the number of threads receiving the UDP packets of all detector modules
+     configReader.lookupValue("numberOfReceiverThreads", numberOfReceiverThreads_);
      return EXIT_SUCCESS;
   }
 
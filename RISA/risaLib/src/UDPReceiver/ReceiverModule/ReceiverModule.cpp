@@ -28,6 +28,7 @@
 #include <boost/asio.hpp>
 #include <boost/asio/buffer.hpp>
 
+#include <algorithm>
 #include <future>
 
 namespace risa {
@@ -35,14 +36,16 @@ namespace risa {
 using tcp = boost::asio::ip::tcp;
 
 ReceiverModule::ReceiverModule(const std::string& address, const std::string& configPath, const int moduleID,
-      std::vector<unsigned short>& buffer, OnlineReceiverNotification& notification) :
-   moduleID_{moduleID},
-   buffer_(buffer),
-   run_{true},
+      const DetectorLayout& layout, InputRing& ring, OnlineReceiverNotification& notification) :
+   udpServer_{address, layout.port(moduleID)},
+   ring_(ring),
+   numberOfDetectorModules_{layout.numberOfModules()},
+   numberOfDetectorsPerModule_{layout.numberOfDetectorsPerModule()},
+   port_{layout.port(moduleID)},
    address_{address},
    notification_(notification),
-   udpServer_{address, 4000+moduleID},
-   port_{4000+moduleID}
+   run_{true},
+   moduleID_{moduleID}
    {
 
    if (readConfig(configPath)) {
@@ -50,15 +53,32 @@ ReceiverModule::ReceiverModule(const std::string& address, const std::string& co
       throw std::runtime_error("ReceiverModule: Configuration file could not be loaded successfully. Please check!");
    }
 
-   BOOST_LOG_TRIVIAL(debug) << "Created Module receiving at " << address << " listening to port " << 4000+moduleID;
+   sinoSize_ = numberOfProjections_*numberOfDetectorsPerModule_;
+   moduleOffset_ = moduleID_*sinoSize_;
+   packetSize_ = numberOfProjectionsPerPacket_*numberOfDetectorsPerModule_;
+   partsPerSinogram_ = numberOfProjections_/numberOfProjectionsPerPacket_;
+   const std::size_t headerSize = sizeof(std::size_t)+sizeof(unsigned short);
+   batch_.reset(new PacketBatch(packetsPerBatch_, headerSize, packetSize_*sizeof(unsigned short)));
+   misplaced_.resize(packetsPerBatch_*packetSize_);
+   packetNumbers_.resize(packetsPerBatch_);
+   wordsPerSlot_ = (partsPerSinogram_ + 63) / 64;
+   receivedParts_.resize(bufferSize_*wordsPerSlot_, 0u);
+   slotIndex_.resize(bufferSize_, -1);
+   slotParts_.resize(bufferSize_, 0u);
+   //incomplete sinograms must be finalized before their slot is reused
+   reorderWindow_ = std::max(1, std::min(reorderWindow_, (int)bufferSize_/2));
+   statistics_.reset(new ReceiverStatistics);
+   if(useIoUring_ && !udpServer_.enable_io_uring(4*packetsPerBatch_, headerSize + packetSize_*sizeof(unsigned short))){
+      BOOST_LOG_TRIVIAL(warning) << "ReceiverModule " << moduleID_ << ": io_uring is not available, falling back to recvmmsg.";
+      useIoUring_ = false;
+   }
+
+   BOOST_LOG_TRIVIAL(debug) << "Created Module " << layout.module(moduleID) << " receiving at " << address << " listening to port " << port_;
 }
 
 auto ReceiverModule::run() -> void {
    std::size_t headerSize{(sizeof(std::size_t)+sizeof(unsigned short))/sizeof(unsigned short)};
    std::vector<unsigned short> buf(numberOfProjectionsPerPacket_*numberOfDetectorsPerModule_ + headerSize);
-   unsigned int sinoSize = numberOfProjections_*numberOfDetectorsPerModule_;
-   int numBytes = 0;
-   unsigned short numberOfParts = numberOfProjections_/numberOfProjectionsPerPacket_ - 1;
    if(transportProtocol_ == transportProtocol::TCP){
       boost::asio::io_service io_service;
 
@@ -76,9 +96,10 @@ auto ReceiverModule::run() -> void {
          std::size_t index = *((std::size_t *)buf.data());
          unsigned short partID = *((unsigned short*)(buf.data() + sizeof(std::size_t)/sizeof(unsigned short)));
          BOOST_LOG_TRIVIAL(debug) << "ReceiverModule " << moduleID_ << " received packet " << index << " part ID: " << partID;
-         std::copy(buf.cbegin() + headerSize, buf.cend(), buffer_.begin() + sinoSize * (index%bufferSize_) + partID * numberOfProjectionsPerPacket_*numberOfDetectorsPerModule_);
-         if(numberOfParts == partID)
-            notification_.notify(moduleID_, index);
+         if(!registerPart(index, partID))
+            continue;
+         std::copy(buf.cbegin() + headerSize, buf.cend(), ring_.slot(index) + moduleOffset_ + partID * packetSize_);
+         notifyIfComplete(index);
       }
    }else if(transportProtocol_ == transportProtocol::UDP){
       //Possibility how to realize timeout with boost::asio::udp was not found yet
@@ -88,31 +109,190 @@ auto ReceiverModule::run() -> void {
       udp::endpoint listen_endpoint(boost::asio::ip::address::from_string(address_), port_);
       socket.open(listen_endpoint.protocol());
       socket.bind(listen_endpoint);*/
-      while(true){
-         numBytes = udpServer_.timed_recv((char*)(buf.data()), buf.size()*sizeof(unsigned short), timeout_);
-         if(numBytes < 0) break;
-         BOOST_LOG_TRIVIAL(debug) << "Number of bytes received: " << numBytes;
-         /*boost::system::error_code ec;
-         std::size_t n = socket.receive_from(boost::asio::buffer(buf.data(), buf.size()*sizeof(unsigned short)), listen_endpoint);
-         */
-         std::size_t index = *((std::size_t *)buf.data());
-         unsigned short partID = *((unsigned short*)(buf.data() + sizeof(std::size_t)/sizeof(unsigned short)));
-         int diff = index*numberOfParts + partID - lastIndex_;
-         if(diff > 1){
-            BOOST_LOG_TRIVIAL(warning) << "ReceiverModule " << moduleID_ << ": Lost package or wrong order. Last " << lastIndex_ << " new: " << index*numberOfParts + partID;
-            lastIndex_ = index*numberOfParts + partID;
-            //continue;
-         }
-         lastIndex_ = index*numberOfParts + partID;
-         BOOST_LOG_TRIVIAL(debug) << "ReceiverModule " << moduleID_ << " received packet " << index << " partID: " << partID;
-         auto it = std::count(buf.cbegin()+headerSize, buf.cend(), 0);
-         std::copy(buf.cbegin() + headerSize, buf.cend(), buffer_.begin() + sinoSize * (index%bufferSize_) + partID * numberOfProjectionsPerPacket_*numberOfDetectorsPerModule_);
-         if(numberOfParts == partID)
-            notification_.notify(moduleID_, index);
+      udpServer_.set_timeout(timeout_);
+      while(receiveBatch() >= 0);
+   }
+   finish();
+}
+
+auto ReceiverModule::receiveBatch() -> int {
+   //the position of a packet in the ring buffer, packets are numbered consecutively over all sinograms
+   auto payloadTarget = [this](std::size_t packetNumber) -> char* {
+      const std::size_t index = packetNumber / partsPerSinogram_;
+      const std::size_t partID = packetNumber % partsPerSinogram_;
+      return (char*)(ring_.slot(index) + moduleOffset_ + partID * packetSize_);
+   };
+   //receive the payloads directly at the position of the next expected packets
+   for(auto packetInd = 0; packetInd < packetsPerBatch_; packetInd++)
+      batch_->set_payload(packetInd, payloadTarget(expectedPacket_ + packetInd));
+   int numPackets = udpServer_.recv_batch(*batch_);
+   if(numPackets < 0) return numPackets;
+   BOOST_LOG_TRIVIAL(debug) << "ReceiverModule " << moduleID_ << ": Number of packets received: " << numPackets;
+   const int packetBytes = batch_->header_size() + packetSize_*sizeof(unsigned short);
+   //lost or reordered packets: save all misplaced payloads first, as they may occupy each other's positions
+   for(auto packetInd = 0; packetInd < numPackets; packetInd++){
+      const char* header = batch_->header(packetInd);
+      std::size_t index = *((const std::size_t *)header);
+      unsigned short partID = *((const unsigned short*)(header + sizeof(std::size_t)));
+      //malformed packets must not be counted as part of another sinogram
+      if(batch_->packet_bytes(packetInd) != packetBytes || partID >= partsPerSinogram_){
+         BOOST_LOG_TRIVIAL(warning) << "ReceiverModule " << moduleID_ << ": Discarding malformed packet of " << batch_->packet_bytes(packetInd)
+               << " bytes with part ID " << partID << ".";
+         statistics_->invalidPackets++;
+         packetNumbers_[packetInd] = invalidPacket;
+         continue;
       }
+      packetNumbers_[packetInd] = index*partsPerSinogram_ + partID;
+      if(packetNumbers_[packetInd] != expectedPacket_ + packetInd)
+         std::copy((const unsigned short*)batch_->payload(packetInd), (const unsigned short*)batch_->payload(packetInd) + packetSize_,
+               misplaced_.begin() + packetInd*packetSize_);
+   }
+   for(auto packetInd = 0; packetInd < numPackets; packetInd++){
+      const std::size_t packetNumber = packetNumbers_[packetInd];
+      if(packetNumber == invalidPacket)
+         continue;
+      const std::size_t index = packetNumber / partsPerSinogram_;
+      const unsigned short partID = packetNumber % partsPerSinogram_;
+      BOOST_LOG_TRIVIAL(debug) << "ReceiverModule " << moduleID_ << " received packet " << index << " partID: " << partID;
+      if(!registerPart(index, partID))
+         continue;
+      if(packetNumber != expectedPacket_ + packetInd)
+         std::copy(misplaced_.cbegin() + packetInd*packetSize_, misplaced_.cbegin() + (packetInd+1)*packetSize_,
+               (unsigned short*)payloadTarget(packetNumber));
+      notifyIfComplete(index);
    }
+   //predict the packets following the newest one, so that no received payload is overwritten
+   for(auto packetInd = 0; packetInd < numPackets; packetInd++)
+      if(packetNumbers_[packetInd] != invalidPacket)
+         expectedPacket_ = std::max(expectedPacket_, packetNumbers_[packetInd] + 1);
+   //give up the sinograms, which dropped out of the reorder window
+   if(started_ && newestIndex_ + 1 > nextIndex_ + reorderWindow_)
+      finalizeSinograms(newestIndex_ + 1 - reorderWindow_);
+   return numPackets;
+}
+
+auto ReceiverModule::finish() -> void {
+   if(started_)
+      finalizeSinograms(newestIndex_ + 1);
    notification_.notify(moduleID_, -1);
    BOOST_LOG_TRIVIAL(info) << "ReceiverModul " << moduleID_ << ": No packets arriving since " << timeout_ << "s. Finishing.";
+   BOOST_LOG_TRIVIAL(info) << "ReceiverModul " << moduleID_ << ": Received " << statistics_->receivedPackets << " packets, "
+         << statistics_->lostPackets << " lost, " << statistics_->latePackets << " too late, " << statistics_->invalidPackets << " invalid. "
+         << statistics_->incompleteSinograms << " sinograms incomplete, " << statistics_->droppedSinograms << " dropped.";
+}
+
+auto ReceiverModule::registerPart(std::size_t index, unsigned short partID) -> bool {
+   if(partID >= partsPerSinogram_){
+      statistics_->invalidPackets++;
+      return false;
+   }
+   if(!started_){
+      started_ = true;
+      nextIndex_ = index;
+      newestIndex_ = index;
+   }
+   if(index < nextIndex_){
+      statistics_->latePackets++;
+      return false;
+   }
+   //the sinogram, which occupies the slot, must be handed over before it is overwritten
+   if(index >= nextIndex_ + bufferSize_)
+      finalizeSinograms(index + 1 - bufferSize_);
+   const std::size_t slot = index % bufferSize_;
+   std::uint64_t* receivedParts = receivedParts_.data() + slot*wordsPerSlot_;
+   if(slotIndex_[slot] != index){
+      slotIndex_[slot] = index;
+      slotParts_[slot] = 0u;
+      std::fill(receivedParts, receivedParts + wordsPerSlot_, 0u);
+   }
+   const std::uint64_t bit = std::uint64_t{1} << (partID%64);
+   if(receivedParts[partID/64] & bit)
+      return false;
+   receivedParts[partID/64] |= bit;
+   slotParts_[slot]++;
+   newestIndex_ = std::max(newestIndex_, index);
+   statistics_->receivedPackets++;
+   return true;
+}
+
+auto ReceiverModule::notifyIfComplete(std::size_t index) -> void {
+   if(slotParts_[index % bufferSize_] == partsPerSinogram_)
+      notification_.notify(moduleID_, index);
+}
+
+auto ReceiverModule::finalizeSinograms(std::size_t end) -> void {
+   if(end <= nextIndex_)
+      return;
+   //these sinograms are overwritten already
+   if(end - nextIndex_ > bufferSize_){
+      const std::size_t overwritten = end - bufferSize_ - nextIndex_;
+      statistics_->droppedSinograms += overwritten;
+      statistics_->lostPackets += overwritten * partsPerSinogram_;
+      nextIndex_ = end - bufferSize_;
+   }
+   for(auto index = nextIndex_; index < end; index++){
+      const std::size_t slot = index % bufferSize_;
+      if(slotIndex_[slot] != index){
+         BOOST_LOG_TRIVIAL(warning) << "ReceiverModule " << moduleID_ << ": No packet of sinogram " << index << " arrived.";
+         statistics_->droppedSinograms++;
+         statistics_->lostPackets += partsPerSinogram_;
+         continue;
+      }
+      if(slotParts_[slot] == partsPerSinogram_)
+         continue;
+      const std::size_t missing = partsPerSinogram_ - slotParts_[slot];
+      BOOST_LOG_TRIVIAL(warning) << "ReceiverModule " << moduleID_ << ": Sinogram " << index << " is incomplete, "
+            << missing << " of " << partsPerSinogram_ << " packets are missing.";
+      statistics_->lostPackets += missing;
+      statistics_->incompleteSinograms++;
+      //the slot may already hold a newer sinogram of another ReceiverModule, which must not be overwritten
+      if(incompletePolicy_ == incompleteSinogramPolicy::DROP || !ring_.holds(index)){
+         statistics_->droppedSinograms++;
+         continue;
+      }
+      fillMissingParts(index);
+      notification_.notify(moduleID_, index);
+   }
+   nextIndex_ = end;
+}
+
+auto ReceiverModule::fillMissingParts(std::size_t index) -> void {
+   const std::size_t slot = index % bufferSize_;
+   unsigned short* sino = ring_.slot(index) + moduleOffset_;
+   const std::uint64_t* receivedParts = receivedParts_.data() + slot*wordsPerSlot_;
+   auto received = [&](std::size_t part) -> bool {
+      return (receivedParts[part/64] >> (part%64)) & 1u;
+   };
+   for(auto part = 0u; part < partsPerSinogram_; part++){
+      if(received(part))
+         continue;
+      unsigned short* target = sino + part*packetSize_;
+      if(incompletePolicy_ == incompleteSinogramPolicy::ZERO){
+         std::fill(target, target + packetSize_, 0u);
+         continue;
+      }
+      //interpolate linearly between the closest received projections, which are periodic over one rotation
+      std::size_t before = part, after = part;
+      do before = (before + partsPerSinogram_ - 1) % partsPerSinogram_; while(!received(before));
+      do after = (after + 1) % partsPerSinogram_; while(!received(after));
+      const int firstProjection = before*numberOfProjectionsPerPacket_ + numberOfProjectionsPerPacket_ - 1;
+      const int lastProjection = after*numberOfProjectionsPerPacket_;
+      const int distance = (lastProjection - firstProjection + numberOfProjections_) % numberOfProjections_;
+      const unsigned short* first = sino + firstProjection*numberOfDetectorsPerModule_;
+      const unsigned short* last = sino + lastProjection*numberOfDetectorsPerModule_;
+      //only one projection was received, it is the closest one for all others
+      if(distance == 0){
+         for(auto projInd = 0; projInd < numberOfProjectionsPerPacket_; projInd++)
+            std::copy(first, first + numberOfDetectorsPerModule_, target + projInd*numberOfDetectorsPerModule_);
+         continue;
+      }
+      for(auto projInd = 0; projInd < numberOfProjectionsPerPacket_; projInd++){
+         const int projection = part*numberOfProjectionsPerPacket_ + projInd;
+         const float w = (float)((projection - firstProjection + numberOfProjections_) % numberOfProjections_) / distance;
+         for(auto detInd = 0; detInd < numberOfDetectorsPerModule_; detInd++)
+            target[projInd*numberOfDetectorsPerModule_ + detInd] = (1.f - w) * first[detInd] + w * last[detInd] + 0.5f;
+      }
+   }
 }
 
 auto ReceiverModule::readConfig(const std::string& configFile) -> bool {
@@ -124,10 +304,8 @@ auto ReceiverModule::readConfig(const std::string& configFile) -> bool {
         && configReader.lookupValue("scanRate", scanRate)
         && configReader.lookupValue("transportProtocol", transportProt)
         && configReader.lookupValue("timeout", timeout_)
-        && configReader.lookupValue("numberOfDetectorsPerModule", numberOfDetectorsPerModule_)
         && configReader.lookupValue("numberOfProjectionsPerPacket", numberOfProjectionsPerPacket_)
-        && configReader.lookupValue("inputBufferSize", bufferSize_)
-        && configReader.lookupValue("numberOfDetectorModules", numberOfDetectorModules_)) {
+        && configReader.lookupValue("inputBufferSize", bufferSize_)) {
      if(transportProt == "udp")
         transportProtocol_ = transportProtocol::UDP;
      else if(transportProt == "tcp")
@@ -135,6 +313,24 @@ auto ReceiverModule::readConfig(const std::string& configFile) -> bool {
      else
         transportProtocol_ = transportProtocol::UDP;
      numberOfProjections_ = samplingRate * 1000000 / scanRate;
+     //optional parameter, the maximum number of packets received with one system call
+     configReader.lookupValue("packetsPerBatch", packetsPerBatch_);
+     //optional parameter, the system interface receiving the UDP packets: "recvmmsg" or "io_uring"
+     std::string receiveBackend;
+     if(configReader.lookupValue("receiveBackend", receiveBackend))
+        useIoUring_ = receiveBackend == "io_uring";
+     //optional parameter, the number of newer sinograms, after which an incomplete sinogram is given up
+     configReader.lookupValue("reorderWindow", reorderWindow_);
+     //optional parameter, the handling of incomplete sinograms: "drop", "zero" or "interpolate"
+     std::string incompleteSinograms;
+     if(configReader.lookupValue("incompleteSinograms", incompleteSinograms)){
+        if(incompleteSinograms == "zero")
+           incompletePolicy_ = incompleteSinogramPolicy::ZERO;
+        else if(incompleteSinograms == "interpolate")
+           incompletePolicy_ = incompleteSinogramPolicy::INTERPOLATE;
+        else
+           incompletePolicy_ = incompleteSinogramPolicy::DROP;
+     }
      return EXIT_SUCCESS;
   }
 